@@ -3,7 +3,10 @@
 //
 
 #include <octree-cpp/OctreeCpp.h>
+#include <octree-cpp/GridOctreeCpp.h>
+#include <octree-cpp/ShardedOctreeCpp.h>
 #include <random>
+#include <ranges>
 #include <benchmark/benchmark.h>
 
 struct vec {
@@ -113,4 +116,225 @@ static void BM_OctreeQueryLarge3d(benchmark::State& state) {
 }
 BENCHMARK(BM_OctreeQueryLarge3d)->DenseRange(0, 500000, 50000);
 
-BENCHMARK_MAIN();
\ No newline at end of file
+BENCHMARK_MAIN();
+static void BM_OctreeQueryCity3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {10000.0f, 10000.0f, 100.0f}});
+
+    std::mt19937 gen(37);
+    std::uniform_real_distribution<float> dis(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> height(0.0f, 100.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), height(gen)}, i});
+    }
+
+    for (auto _ : state) {
+        auto result = octree.Query(SphereQuery<Oct::TDataWrapper>{{5000.0f, 5000.0f, 50.0f}, 50.0f});
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_OctreeQueryCity3d)->Arg(100000)->Arg(500000);
+
+static void BM_GridOctreeQueryCity3d(benchmark::State& state) {
+    using Grid = GridOctreeCpp<vec, int>;
+    Grid grid({{0.0f, 0.0f, 0.0f}, {10000.0f, 10000.0f, 100.0f}}, 64);
+
+    std::mt19937 gen(37);
+    std::uniform_real_distribution<float> dis(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> height(0.0f, 100.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        grid.Add({{dis(gen), dis(gen), height(gen)}, i});
+    }
+
+    for (auto _ : state) {
+        auto result = grid.Query(Grid::Sphere{{5000.0f, 5000.0f, 50.0f}, 50.0f});
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_GridOctreeQueryCity3d)->Arg(100000)->Arg(500000);
+
+static void BM_OctreeQueryRangeTake100(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(38);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+
+    for (auto _ : state) {
+        int sum = 0;
+        for (const auto& data : octree.QueryRange(Oct::Sphere{{0.5f, 0.5f, 0.5f}, 0.5f}) | std::views::take(100)) {
+            sum += data.Data;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_OctreeQueryRangeTake100)->Arg(100000)->Arg(500000);
+
+static void BM_FrozenOctreeQuerySmall3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(40);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+    auto frozen = std::move(octree).Freeze();
+
+    for (auto _ : state) {
+        auto result = frozen.Query(SphereQuery<Oct::TDataWrapper>{{0.5f, 0.5f, 0.5f}, 0.5f});
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FrozenOctreeQuerySmall3d)->Arg(100000)->Arg(500000);
+
+static void BM_FrozenOctreeQueryLarge3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(40);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+    auto frozen = std::move(octree).Freeze();
+
+    for (auto _ : state) {
+        auto result = frozen.Query(SphereQuery<Oct::TDataWrapper>{{0.5f, 0.5f, 0.5f}, 1.5f});
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FrozenOctreeQueryLarge3d)->Arg(100000)->Arg(500000);
+
+static void BM_OctreeHistogram3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(41);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+
+    for (auto _ : state) {
+        auto result = octree.Histogram({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}, 16);
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_OctreeHistogram3d)->Arg(100000)->Arg(500000);
+
+static void BM_OctreeMovingQuery3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+
+    int tick = 0;
+    for (auto _ : state) {
+        float x = 0.2f + 0.0001f * static_cast<float>(tick++ % 1000);
+        auto result = octree.QueryRefs(Oct::Sphere{{x, 0.3f, 0.3f}, 0.01f});
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_OctreeMovingQuery3d)->Arg(500000);
+
+static void BM_OctreeMovingQueryCursor3d(benchmark::State& state) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < state.range(0); i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+
+    int tick = 0;
+    auto cursor = octree.CreateCursor(Oct::Sphere{{0.2f, 0.3f, 0.3f}, 0.01f});
+    for (auto _ : state) {
+        float x = 0.2f + 0.0001f * static_cast<float>(tick++ % 1000);
+        cursor.Update(Oct::Sphere{{x, 0.3f, 0.3f}, 0.01f});
+        benchmark::DoNotOptimize(cursor.GetResults().data());
+    }
+}
+BENCHMARK(BM_OctreeMovingQueryCursor3d)->Arg(500000);
+
+static void BM_ShardedOctreeQueryLarge3d(benchmark::State& state) {
+    using Oct = ShardedOctreeCpp<vec, int>;
+    Oct octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}, state.range(0));
+
+    std::mt19937 gen(46);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < 2000000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+    octree.Flush();
+
+    // A thin query so the shards spend their time in the octree and not on sending results.
+    auto query = Oct::Cylinder{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, 0.02f};
+    for (auto _ : state) {
+        auto result = octree.Query(query);
+        benchmark::DoNotOptimize(result);
+        benchmark::ClobberMemory();
+    }
+    // Queries per second, the shards only run at the same time when there are as many cores.
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedOctreeQueryLarge3d)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+static void BM_OctreeAddLoop3d(benchmark::State& state) {
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<BasicOctree::TDataWrapper> existing;
+    std::vector<BasicOctree::TDataWrapper> batch;
+    for (int i = 0; i < 1000000; i++) {
+        existing.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (int i = 0; i < state.range(0); i++) {
+        batch.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        BasicOctree octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+        octree.AddBatch(existing);
+        state.ResumeTiming();
+        for (const auto& data : batch) {
+            octree.Add(data);
+        }
+        benchmark::DoNotOptimize(octree);
+    }
+}
+BENCHMARK(BM_OctreeAddLoop3d)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_OctreeAddBatch3d(benchmark::State& state) {
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<BasicOctree::TDataWrapper> existing;
+    std::vector<BasicOctree::TDataWrapper> batch;
+    for (int i = 0; i < 1000000; i++) {
+        existing.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (int i = 0; i < state.range(0); i++) {
+        batch.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        BasicOctree octree({{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+        octree.AddBatch(existing);
+        state.ResumeTiming();
+        octree.AddBatch(batch, state.range(1));
+        benchmark::DoNotOptimize(octree);
+    }
+}
+BENCHMARK(BM_OctreeAddBatch3d)->Args({100000, 0})->Args({100000, 1})->Args({1000000, 0})->Args({1000000, 1})->Unit(benchmark::kMillisecond)->UseRealTime();
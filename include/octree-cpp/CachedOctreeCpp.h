@@ -0,0 +1,294 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <list>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The parameters of the built in queries that are used as the key in the query cache.
+ */
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams(const SphereQuery<TDataWrapper>& Query) {
+    auto params = ToArray(Query.Midpoint);
+    std::vector<float> result(params.begin(), params.end());
+    result.push_back(Query.Radius);
+    return result;
+}
+
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams(const CircleQuery<TDataWrapper>& Query) {
+    auto params = ToArray(Query.Midpoint);
+    std::vector<float> result(params.begin(), params.end());
+    result.push_back(Query.Radius);
+    return result;
+}
+
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams(const CylinderQuery<TDataWrapper>& Query) {
+    auto point1 = ToArray(Query.Point1);
+    auto point2 = ToArray(Query.Point2);
+    std::vector<float> result(point1.begin(), point1.end());
+    result.insert(result.end(), point2.begin(), point2.end());
+    result.push_back(Query.Radius);
+    return result;
+}
+
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams(const BoxQuery<TDataWrapper>& Query) {
+    auto min = ToArray(Query.Bounds.Min);
+    auto max = ToArray(Query.Bounds.Max);
+    std::vector<float> result(min.begin(), min.end());
+    result.insert(result.end(), max.begin(), max.end());
+    return result;
+}
+
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams(const PeriodicSphereQuery<TDataWrapper>& Query) {
+    auto midpoint = ToArray(Query.Midpoint);
+    auto min = ToArray(Query.Period.Min);
+    auto max = ToArray(Query.Period.Max);
+    std::vector<float> result(midpoint.begin(), midpoint.end());
+    result.push_back(Query.Radius);
+    result.insert(result.end(), min.begin(), min.end());
+    result.insert(result.end(), max.begin(), max.end());
+    return result;
+}
+
+template <typename TDataWrapper>
+std::vector<float> GetQueryParams([[maybe_unused]] const AllQuery<TDataWrapper>& Query) {
+    return {};
+}
+
+/**
+ * Queries that can be cached, the query is fully described by its type and its parameters.
+ * Queries with a NaN parameter are never cached, since NaN is not equal to itself they could never be found again.
+ */
+template <typename TQuery, typename TDataWrapper>
+concept IsCacheableQuery = IsQuery<TQuery, TDataWrapper> && std::copy_constructible<TQuery> && requires(const TQuery& Query) {
+    { GetQueryParams(Query) } -> std::convertible_to<std::vector<float>>;
+};
+
+/**
+ * An octree that caches the results of repeated queries. Only the built in queries that
+ * satisfy IsCacheableQuery are cached, other queries go straight to the octree.
+ * The cache holds at most MaxEntries results and evicts the least recently used one.
+ * When data is added only the cached results of queries that the new data is inside of are dropped.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ */
+template <typename TVector, typename TData>
+requires VectorLike<TVector> && std::copy_constructible<TData>
+class CachedOctreeCpp {
+public:
+    using Tree = OctreeCpp<TVector, TData>;
+    using TDataWrapper = typename Tree::TDataWrapper;
+    using TBoundary = typename Tree::TBoundary;
+
+    using Sphere = typename Tree::Sphere;
+    using Circle = typename Tree::Circle;
+    using Cylinder = typename Tree::Cylinder;
+    using Box = typename Tree::Box;
+    using Pred = typename Tree::Pred;
+    using All = typename Tree::All;
+
+    /**
+     * Constructor to setup the cached Octree.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     * @param MaxEntries Max number of query results that are kept in the cache.
+     * @param Split How nodes choose the point they are split at.
+     * @param Bounds What happens when data is added outside of the boundary.
+     */
+    explicit CachedOctreeCpp(TBoundary Boundary, size_t MaxEntries = 64, SplitPolicy Split = SplitPolicy::Midpoint, BoundaryPolicy Bounds = BoundaryPolicy::Fixed)
+        : Octree(Boundary, Split, Bounds)
+        , MaxEntries(MaxEntries)
+        , Bounds(Bounds) {
+    }
+
+    /**
+     * Stores the given data in the octree container and drops the cached results it changes.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) {
+        Octree.Add(DataWrapper);
+        Invalidate(DataWrapper);
+    }
+
+    /**
+     * Stores the given data in the octree container, moves the payload instead of copying it.
+     * @param DataWrapper
+     */
+    void Add(TDataWrapper&& DataWrapper) {
+        Invalidate(DataWrapper);
+        Octree.Add(std::move(DataWrapper));
+    }
+
+    /**
+     * Stores all the given data in the octree container, see OctreeCpp::AddBatch, and drops the cached
+     * results it changes.
+     *
+     * @param Data The data to add.
+     * @param Parallel Fills the subtrees of the root on several threads.
+     */
+    void AddBatch(std::span<const TDataWrapper> Data, bool Parallel = false) {
+        Octree.AddBatch(Data, Parallel);
+        for (const auto& data : Data) {
+            Invalidate(data);
+        }
+    }
+
+    /**
+     * Queries the octree, the result is served from the cache if the same query was done
+     * before and no data inside of it has been added since.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) {
+        if constexpr (IsCacheableQuery<TQueryObject, TDataWrapper>) {
+            Key key{std::type_index(typeid(TQueryObject)), GetQueryParams(QueryObject)};
+            if (std::any_of(key.Params.begin(), key.Params.end(), [](float Param) { return std::isnan(Param); })) {
+                return Octree.Query(QueryObject);
+            }
+            if (auto it = Lookup.find(key); it != Lookup.end()) {
+                NrHits++;
+                Entries.splice(Entries.begin(), Entries, it->second);
+                return it->second->Result;
+            }
+            NrMisses++;
+            auto result = Octree.Query(QueryObject);
+            if (MaxEntries > 0) {
+                Insert(std::move(key), QueryObject, result);
+            }
+            return result;
+        } else {
+            return Octree.Query(QueryObject);
+        }
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return Octree.Size();
+    }
+
+    /**
+     * @return The boundraries of the octree.
+     */
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+        return Octree.GetBoundaries();
+    }
+
+    /**
+     * @return The octree the cache is in front of.
+     */
+    [[nodiscard]] const Tree& GetOctree() const {
+        return Octree;
+    }
+
+    /**
+     * @return Number of queries that were served from the cache.
+     */
+    [[nodiscard]] size_t Hits() const {
+        return NrHits;
+    }
+
+    /**
+     * @return Number of cacheable queries that had to query the octree.
+     */
+    [[nodiscard]] size_t Misses() const {
+        return NrMisses;
+    }
+
+    /**
+     * @return Number of query results in the cache.
+     */
+    [[nodiscard]] size_t CacheSize() const {
+        return Entries.size();
+    }
+
+    /**
+     * Drops all cached results.
+     */
+    void ClearCache() {
+        Entries.clear();
+        Lookup.clear();
+    }
+
+private:
+    struct Key {
+        std::type_index Type;
+        std::vector<float> Params;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& Key) const {
+            size_t hash = Key.Type.hash_code();
+            for (float param : Key.Params) {
+                hash ^= std::hash<float>()(param) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+    struct Entry {
+        Key CacheKey;
+        std::function<bool(const TDataWrapper&)> IsInside;
+        std::vector<TDataWrapper> Result;
+    };
+
+    template <typename TQueryObject>
+    void Insert(Key CacheKey, const TQueryObject& QueryObject, const std::vector<TDataWrapper>& Result) {
+        if (Entries.size() >= MaxEntries) {
+            Lookup.erase(Entries.back().CacheKey);
+            Entries.pop_back();
+        }
+        Entries.push_front({std::move(CacheKey), [QueryObject](const TDataWrapper& Data) {
+            return QueryObject.IsInside(Data);
+        }, Result});
+        Lookup.emplace(Entries.front().CacheKey, Entries.begin());
+    }
+
+    /**
+     * Drops the cached results that the data is inside of, tested with the position the octree stores it at.
+     */
+    void Invalidate(const TDataWrapper& Data) {
+        if (Bounds == BoundaryPolicy::Periodic) {
+            auto wrapped = Data;
+            wrapped.Vector = WrapPoint(Data.Vector, Octree.GetBoundary());
+            InvalidateStored(wrapped);
+        } else {
+            InvalidateStored(Data);
+        }
+    }
+
+    void InvalidateStored(const TDataWrapper& Data) {
+        for (auto it = Entries.begin(); it != Entries.end();) {
+            if (it->IsInside(Data)) {
+                Lookup.erase(it->CacheKey);
+                it = Entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    Tree Octree;
+    size_t MaxEntries;
+    BoundaryPolicy Bounds;
+    std::list<Entry> Entries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> Lookup;
+    size_t NrHits = 0;
+    size_t NrMisses = 0;
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <bit>
+#include <vector>
+
+/**
+ * An immutable copy of an OctreeCpp that is laid out for fast queries. The nodes are stored in
+ * breadth first order where the children of a node are next to each other, so a node only stores
+ * the index of its first child and a bitmask of which sections have a child. The data is packed in
+ * one array in the same order as the nodes. All functions are const and don't modify any state,
+ * so a frozen octree can be queried from several threads at the same time without locking.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ */
+template <typename TVector, typename TData>
+requires VectorLike<TVector>
+class FrozenOctreeCpp {
+private:
+    using Source = OctreeCpp<TVector, TData>;
+    static constexpr size_t NrSections = ::NrSections<TVector>();
+    static constexpr size_t MaxDepth = Source::MaxDepth;
+    static_assert(NrSections <= 32);
+
+public:
+    using TDataWrapper = typename Source::TDataWrapper;
+    using TBoundary = typename Source::TBoundary;
+
+    using Sphere = typename Source::Sphere;
+    using Circle = typename Source::Circle;
+    using Cylinder = typename Source::Cylinder;
+    using Box = typename Source::Box;
+    using Pred = typename Source::Pred;
+    using All = typename Source::All;
+
+    /**
+     * Copies the octree into the frozen layout.
+     * @param Octree
+     */
+    explicit FrozenOctreeCpp(const Source& Octree) requires std::copy_constructible<TData>
+        : BoundaryData(Octree.BoundaryData) {
+        Build(Octree, [&](NodeIndex Index) {
+            for (const auto& data : Octree.DataBlocks[Index]) {
+                Data.push_back(data);
+            }
+        });
+    }
+
+    /**
+     * Moves the data of the octree into the frozen layout.
+     * @param Octree
+     */
+    explicit FrozenOctreeCpp(Source&& Octree)
+        : BoundaryData(Octree.BoundaryData) {
+        Build(Octree, [&](NodeIndex Index) {
+            for (auto& data : Octree.DataBlocks[Index]) {
+                Data.push_back(std::move(data));
+            }
+        });
+    }
+
+    /**
+     * Queries the octree and returns all results that returns a hit, in the same order as
+     * the octree it was frozen from.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) const {
+        std::vector<TDataWrapper> result;
+        QueryInternal(QueryObject, [&result](const TDataWrapper& Data) {
+            result.push_back(Data);
+        });
+        return result;
+    }
+
+    /**
+     * Queries the octree and returns references to the stored data instead of copies.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of references to the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<std::reference_wrapper<const TDataWrapper>> QueryRefs(const TQueryObject& QueryObject) const {
+        std::vector<std::reference_wrapper<const TDataWrapper>> result;
+        QueryInternal(QueryObject, [&result](const TDataWrapper& Data) {
+            result.push_back(std::cref(Data));
+        });
+        return result;
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return Data.size();
+    }
+
+    /**
+     * @return The boundary of the root of the octree.
+     */
+    [[nodiscard]] const TBoundary& GetBoundary() const {
+        return BoundaryData;
+    }
+
+    /**
+     * @return The boundraries of the octree.
+     */
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+        std::vector<TBoundary> result;
+        Traverse([](const TBoundary&) {
+            return true;
+        }, [&result](const NodeRef& Node) {
+            result.push_back(Node.Bound);
+        });
+        return result;
+    }
+
+private:
+    using NodeIndex = uint32_t;
+
+    /**
+     * The data of node i is Data[Nodes[i].DataBegin, Nodes[i + 1].DataBegin), there is one extra
+     * node at the end that marks the end of the data.
+     */
+    struct Node {
+        NodeIndex FirstChild = 0;
+        uint32_t DataBegin = 0;
+        uint32_t ChildMask = 0;
+    };
+
+    struct NodeRef {
+        NodeIndex Index = 0;
+        TBoundary Bound;
+    };
+
+    struct TraversalStack {
+        std::array<NodeRef, MaxDepth * (NrSections - 1) + 1> Refs;
+        size_t Count = 0;
+
+        [[nodiscard]] bool empty() const { return Count == 0; }
+        void push(const NodeRef& Ref) { Refs[Count++] = Ref; }
+        NodeRef pop() { return Refs[--Count]; }
+    };
+
+    template <typename TSource, typename TTakeData>
+    void Build(TSource& Octree, TTakeData&& TakeData) {
+        if (Octree.NrObjects > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("Too much data to freeze");
+        }
+        std::vector<typename Source::NodeRef> queue;
+        queue.reserve(Octree.Nodes.size());
+        queue.push_back(Octree.GetRoot());
+        Nodes.reserve(Octree.Nodes.size() + 1);
+        SplitPoints.reserve(Octree.Nodes.size());
+        Data.reserve(Octree.NrObjects);
+        for (size_t i = 0; i < queue.size(); i++) {
+            auto source = queue[i];
+            Node node;
+            node.FirstChild = static_cast<NodeIndex>(queue.size());
+            node.DataBegin = static_cast<uint32_t>(Data.size());
+            for (size_t section = 0; section < NrSections; section++) {
+                if (Octree.Nodes[source.Index].Children[section] != Source::NoNode) {
+                    node.ChildMask |= 1u << section;
+                }
+            }
+            for (const auto& child : Octree.GetChildren(source)) {
+                queue.push_back(child);
+            }
+            Nodes.push_back(node);
+            SplitPoints.push_back(Octree.GetSplitPoint(source));
+            TakeData(source.Index);
+        }
+        Node end;
+        end.DataBegin = static_cast<uint32_t>(Data.size());
+        Nodes.push_back(end);
+    }
+
+    template <typename TCovers, typename TVisit>
+    void Traverse(TCovers&& Covers, TVisit&& Visit) const {
+        TraversalStack stack;
+        stack.push({0, BoundaryData});
+        while (!stack.empty()) {
+            auto parent = stack.pop();
+            const auto& node = Nodes[parent.Index];
+            Prefetch(Data.data() + node.DataBegin);
+            const auto& split = SplitPoints[parent.Index];
+            for (size_t i = NrSections; i-- > 0;) {
+                if (!((node.ChildMask >> i) & 1u)) {
+                    continue;
+                }
+                auto childBound = GetBoundaryFromSection(i, parent.Bound, split);
+                if (Covers(childBound)) {
+                    NodeIndex child = node.FirstChild + std::popcount(node.ChildMask & ((1u << i) - 1));
+                    Prefetch(&Nodes[child]);
+                    stack.push({child, childBound});
+                }
+            }
+            Visit(parent);
+        }
+    }
+
+    template <IsQuery<TDataWrapper> TQueryObject, typename TCallback>
+    void QueryInternal(const TQueryObject& QueryObject, TCallback&& Callback) const {
+        Traverse([&QueryObject](const TBoundary& Bound) {
+            return QueryObject.Covers(Bound);
+        }, [&](const NodeRef& Ref) {
+            auto end = Nodes[Ref.Index + 1].DataBegin;
+            for (auto i = Nodes[Ref.Index].DataBegin; i < end; i++) {
+                if (QueryObject.IsInside(Data[i])) {
+                    Callback(Data[i]);
+                }
+            }
+        });
+    }
+
+    TBoundary BoundaryData;
+    std::vector<Node> Nodes;
+    std::vector<TVector> SplitPoints;
+    std::vector<TDataWrapper> Data;
+};
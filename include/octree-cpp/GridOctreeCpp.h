@@ -0,0 +1,292 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/**
+ * A uniform grid of octrees. The boundary is split into CellsPerAxis cells along every axis and
+ * every cell owns its own octree that is created the first time data is added to it.
+ * Adding data goes straight to the cell of the data, and queries with known bounds only visit the
+ * cells that overlap those bounds, which skips the top levels of a single large octree.
+ * Suited for large worlds where the data is roughly uniformly spread out.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ */
+template <typename TVector, typename TData>
+requires VectorLike<TVector>
+class GridOctreeCpp {
+private:
+    static constexpr size_t Dim = Dimensions<TVector>();
+
+public:
+    using Tree = OctreeCpp<TVector, TData>;
+    using TDataWrapper = typename Tree::TDataWrapper;
+    using TBoundary = typename Tree::TBoundary;
+
+    using Sphere = typename Tree::Sphere;
+    using Circle = typename Tree::Circle;
+    using Cylinder = typename Tree::Cylinder;
+    using Box = typename Tree::Box;
+    using Pred = typename Tree::Pred;
+    using All = typename Tree::All;
+
+    /**
+     * Constructor to setup the grid.
+     *
+     * @param Boundary min and max X, Y, Z values of the grid.
+     * @param CellsPerAxis Number of cells along every axis, at least 1.
+     * @param Split How the nodes of the cell octrees choose the point they are split at.
+     */
+    explicit GridOctreeCpp(TBoundary Boundary, size_t CellsPerAxis = 16, SplitPolicy Split = SplitPolicy::Midpoint)
+        : BoundaryData(Boundary)
+        , CellsPerAxis(CellsPerAxis)
+        , Split(Split) {
+        if (CellsPerAxis == 0) {
+            throw std::runtime_error("Invalid number of cells");
+        }
+        size_t nrCells = 1;
+        for (size_t i = 0; i < Dim; i++) {
+            nrCells *= CellsPerAxis;
+        }
+        Cells.resize(nrCells);
+    }
+
+    /**
+     * Stores the given data in the octree of its cell.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) requires std::copy_constructible<TData> {
+        Add(TDataWrapper(DataWrapper));
+    }
+
+    /**
+     * Stores the given data in the octree of its cell, moves the payload instead of copying it.
+     * @param DataWrapper
+     */
+    void Add(TDataWrapper&& DataWrapper) {
+        GetOrCreateCell(LocateCell(DataWrapper.Vector)).Add(std::move(DataWrapper));
+        NrObjects++;
+    }
+
+    /**
+     * Stores all the given data, the data is first sorted into cells and then every cell is built
+     * on its own. The data in a cell is added in the same order as in Data.
+     *
+     * @param Data The data to add.
+     * @param Parallel Builds the cells on several threads.
+     */
+    void AddBatch(std::span<const TDataWrapper> Data, bool Parallel = false) requires std::copy_constructible<TData> {
+        std::vector<std::vector<size_t>> perCell(Cells.size());
+        std::vector<size_t> touched;
+        for (size_t i = 0; i < Data.size(); i++) {
+            size_t cell = LocateCell(Data[i].Vector);
+            if (perCell[cell].empty()) {
+                touched.push_back(cell);
+            }
+            perCell[cell].push_back(i);
+        }
+        for (size_t cell : touched) {
+            GetOrCreateCell(cell);
+        }
+        auto build = [&](size_t Index) {
+            size_t cell = touched[Index];
+            for (size_t i : perCell[cell]) {
+                Cells[cell]->Add(Data[i]);
+            }
+        };
+        if (Parallel) {
+            ParallelFor(touched.size(), build);
+        } else {
+            for (size_t i = 0; i < touched.size(); i++) {
+                build(i);
+            }
+        }
+        NrObjects += Data.size();
+    }
+
+    /**
+     * Queries the cells that the query covers and returns all results that returns a hit.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) const {
+        std::vector<TDataWrapper> result;
+        ForEachCell(QueryObject, [&](const Tree& Cell) {
+            auto hits = Cell.Query(QueryObject);
+            result.insert(result.end(), std::make_move_iterator(hits.begin()), std::make_move_iterator(hits.end()));
+        });
+        return result;
+    }
+
+    /**
+     * Same as Query but returns references to the stored data instead of copies.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of references to the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<std::reference_wrapper<const TDataWrapper>> QueryRefs(const TQueryObject& QueryObject) const {
+        std::vector<std::reference_wrapper<const TDataWrapper>> result;
+        ForEachCell(QueryObject, [&](const Tree& Cell) {
+            auto hits = Cell.QueryRefs(QueryObject);
+            result.insert(result.end(), hits.begin(), hits.end());
+        });
+        return result;
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return NrObjects;
+    }
+
+    /**
+     * @return Number of cells that holds an octree.
+     */
+    [[nodiscard]] size_t NrCells() const {
+        return Occupied.size();
+    }
+
+    /**
+     * @return The boundraries of all the cell octrees.
+     */
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+        std::vector<TBoundary> result;
+        for (size_t cell : Occupied) {
+            auto boundaries = Cells[cell]->GetBoundaries();
+            result.insert(result.end(), boundaries.begin(), boundaries.end());
+        }
+        return result;
+    }
+
+private:
+    float GetCellMin(size_t Axis, size_t Index) const {
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        if (Index == 0) {
+            return min[Axis];
+        }
+        if (Index >= CellsPerAxis) {
+            return max[Axis];
+        }
+        return min[Axis] + (max[Axis] - min[Axis]) * static_cast<float>(Index) / static_cast<float>(CellsPerAxis);
+    }
+
+    TBoundary GetCellBoundary(size_t Cell) const {
+        std::array<float, Dim> min;
+        std::array<float, Dim> max;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            size_t index = Cell % CellsPerAxis;
+            Cell /= CellsPerAxis;
+            min[axis] = GetCellMin(axis, index);
+            max[axis] = GetCellMin(axis, index + 1);
+        }
+        return {FromArray<TVector>(min), FromArray<TVector>(max)};
+    }
+
+    /**
+     * @return Index of the cell along the axis, clamped to the grid.
+     */
+    size_t GetAxisIndex(size_t Axis, float Value) const {
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        float cell = std::floor((Value - min[Axis]) / (max[Axis] - min[Axis]) * static_cast<float>(CellsPerAxis));
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        auto index = std::min(static_cast<size_t>(cell), CellsPerAxis - 1);
+        // Rounding can put a value right at a cell edge on the wrong side of it.
+        if (index > 0 && Value < GetCellMin(Axis, index)) {
+            index--;
+        } else if (index + 1 < CellsPerAxis && Value > GetCellMin(Axis, index + 1)) {
+            index++;
+        }
+        return index;
+    }
+
+    size_t LocateCell(const TVector& Position) const {
+        if (!IsPointInBoundrary(Position, BoundaryData)) {
+            throw std::runtime_error("Data is outside of boundary");
+        }
+        auto values = ToArray(Position);
+        size_t cell = 0;
+        for (size_t axis = Dim; axis-- > 0;) {
+            cell = cell * CellsPerAxis + GetAxisIndex(axis, values[axis]);
+        }
+        return cell;
+    }
+
+    Tree& GetOrCreateCell(size_t Cell) {
+        if (!Cells[Cell]) {
+            Cells[Cell] = std::make_unique<Tree>(GetCellBoundary(Cell), Split);
+            Occupied.push_back(Cell);
+        }
+        return *Cells[Cell];
+    }
+
+    template <typename TQueryObject, typename TCallback>
+    void ForEachCell(const TQueryObject& QueryObject, TCallback&& Callback) const {
+        if constexpr (HasQueryBounds<TQueryObject, TDataWrapper>) {
+            auto bounds = GetQueryBounds(QueryObject);
+            if (DistanceSquared(bounds, BoundaryData) > 0.0f) {
+                return;
+            }
+            auto min = ToArray(bounds.Min);
+            auto max = ToArray(bounds.Max);
+            std::array<size_t, Dim> first;
+            std::array<size_t, Dim> last;
+            for (size_t axis = 0; axis < Dim; axis++) {
+                first[axis] = GetAxisIndex(axis, min[axis]);
+                last[axis] = GetAxisIndex(axis, max[axis]);
+                // Data right at a cell edge can be in either cell.
+                if (first[axis] > 0 && min[axis] <= GetCellMin(axis, first[axis])) {
+                    first[axis]--;
+                }
+                if (last[axis] + 1 < CellsPerAxis && max[axis] >= GetCellMin(axis, last[axis] + 1)) {
+                    last[axis]++;
+                }
+            }
+            auto index = first;
+            while (true) {
+                size_t cell = 0;
+                for (size_t axis = Dim; axis-- > 0;) {
+                    cell = cell * CellsPerAxis + index[axis];
+                }
+                if (Cells[cell] && QueryObject.Covers(Cells[cell]->GetBoundary())) {
+                    Callback(*Cells[cell]);
+                }
+                size_t axis = 0;
+                while (axis < Dim && index[axis] == last[axis]) {
+                    index[axis] = first[axis];
+                    axis++;
+                }
+                if (axis == Dim) {
+                    break;
+                }
+                index[axis]++;
+            }
+        } else {
+            for (size_t cell : Occupied) {
+                if (QueryObject.Covers(Cells[cell]->GetBoundary())) {
+                    Callback(*Cells[cell]);
+                }
+            }
+        }
+    }
+
+    TBoundary BoundaryData;
+    size_t CellsPerAxis;
+    SplitPolicy Split;
+    std::vector<std::unique_ptr<Tree>> Cells;
+    std::vector<size_t> Occupied;
+    size_t NrObjects = 0;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "OctreeUtil.h"
+#include "OctreeQuery.h"
+#include <memory>
+#include <vector>
+
+/**
+ * Pairs a payload with the boundary of the object it belongs to.
+ */
+template <VectorLike TVector, typename TData>
+struct BoundaryWrapper {
+    using VectorType = TVector;
+    using DataT = TData;
+
+    Boundary<TVector> Bounds;
+    DataT Data;
+};
+
+/**
+ * A loose octree that stores objects with an extent instead of points. Every node has a
+ * loose boundary that is its regular boundary scaled by the looseness factor, and an object
+ * is stored in the deepest node whose loose boundary fully contains the object.
+ * Queries are tested against the extent of the objects using the Covers part of the query.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ */
+template <typename TVector, typename TData>
+requires VectorLike<TVector>
+class LooseOctreeCpp {
+private:
+    static constexpr size_t MaxData = 8;
+    static constexpr size_t MaxDepth = 16;
+
+public:
+    using TBoundaryWrapper = BoundaryWrapper<TVector, TData>;
+    using TDataWrapper = DataWrapper<TVector, TData>;
+    using TBoundary = Boundary<TVector>;
+
+    using Sphere = SphereQuery<TDataWrapper>;
+    using Circle = CircleQuery<TDataWrapper>;
+    using Cylinder = CylinderQuery<TDataWrapper>;
+    using All = AllQuery<TDataWrapper>;
+
+    /**
+     * Constructor to setup the loose Octree.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     * @param Looseness How much larger the loose boundary of a node is than its boundary, at least 1.
+     */
+    explicit LooseOctreeCpp(TBoundary Boundary, float Looseness = 2.0f)
+        : LooseOctreeCpp(Boundary, Looseness, 0) {
+    }
+
+    /**
+     * Stores the given object in the octree container.
+     * @param BoundaryWrapper
+     */
+    void Add(const TBoundaryWrapper& BoundaryWrapper) requires std::copy_constructible<TData> {
+        Add(TBoundaryWrapper(BoundaryWrapper));
+    }
+
+    /**
+     * Stores the given object in the octree container, moves the payload instead of copying it.
+     * @param BoundaryWrapper
+     */
+    void Add(TBoundaryWrapper&& BoundaryWrapper) {
+        if (!IsBoundaryInBoundary(BoundaryWrapper.Bounds, LooseBoundaryData)) {
+            throw std::runtime_error("Boundary is outside of boundary");
+        }
+        AddInternal(std::move(BoundaryWrapper));
+    }
+
+    /**
+     * Queries the octree and returns all objects whose extent the query covers.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TBoundaryWrapper> Query(const TQueryObject& QueryObject) const {
+        std::vector<TBoundaryWrapper> result;
+        QueryInternal(QueryObject, [&result](const TBoundaryWrapper& Data) {
+            result.push_back(Data);
+        });
+        return result;
+    }
+
+    /**
+     * Queries the octree and returns references to the stored objects instead of copies.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of references to the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<std::reference_wrapper<const TBoundaryWrapper>> QueryRefs(const TQueryObject& QueryObject) const {
+        std::vector<std::reference_wrapper<const TBoundaryWrapper>> result;
+        QueryInternal(QueryObject, [&result](const TBoundaryWrapper& Data) {
+            result.push_back(std::cref(Data));
+        });
+        return result;
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return NrObjects;
+    }
+
+    /**
+     * @return The loose boundraries of the octree.
+     */
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+        std::vector<TBoundary> result;
+        GetBoundariesInternal(result);
+        return result;
+    }
+
+private:
+    LooseOctreeCpp(TBoundary Boundary, float Looseness, size_t Depth)
+        : BoundaryData(Boundary)
+        , LooseBoundaryData(GetScaledBoundary(Boundary, Looseness))
+        , Looseness(Looseness)
+        , Depth(Depth) {
+        if (Looseness < 1.0f) {
+            throw std::runtime_error("Looseness needs to be at least 1");
+        }
+    }
+
+    void AddInternal(TBoundaryWrapper&& BoundaryWrapper) {
+        LooseOctreeCpp* node = this;
+        while (true) {
+            node->NrObjects++;
+            if (!node->IsSplit) {
+                node->Data.push_back(std::move(BoundaryWrapper));
+                if (node->Data.size() > MaxData && node->Depth < MaxDepth) {
+                    node->SplitNode();
+                }
+                return;
+            }
+
+            size_t section = LocateSection(BoundaryWrapper.Bounds.GetMidpoint(), node->BoundaryData.GetMidpoint());
+            auto index = static_cast<int>(section);
+            if (!node->Children[index]) {
+                auto childBoundary = GetBoundaryFromSection(section, node->BoundaryData, node->BoundaryData.GetMidpoint());
+                if (!IsBoundaryInBoundary(BoundaryWrapper.Bounds, GetScaledBoundary(childBoundary, Looseness))) {
+                    node->Data.push_back(std::move(BoundaryWrapper));
+                    return;
+                }
+                node->Children[index].reset(new LooseOctreeCpp(childBoundary, Looseness, node->Depth + 1));
+            } else if (!IsBoundaryInBoundary(BoundaryWrapper.Bounds, node->Children[index]->LooseBoundaryData)) {
+                node->Data.push_back(std::move(BoundaryWrapper));
+                return;
+            }
+            node = node->Children[index].get();
+        }
+    }
+
+    void SplitNode() {
+        IsSplit = true;
+        auto data = std::move(Data);
+        Data.clear();
+        NrObjects -= data.size();
+        for (auto& object : data) {
+            AddInternal(std::move(object));
+        }
+    }
+
+    template <IsQuery<TDataWrapper> TQueryObject, typename TCallback>
+    void QueryInternal(const TQueryObject& QueryObject, TCallback&& Callback) const {
+        for (const auto& data : Data) {
+            if (QueryObject.Covers(data.Bounds)) {
+                Callback(data);
+            }
+        }
+        for (const auto& child : Children) {
+            if (child && QueryObject.Covers(child->LooseBoundaryData)) {
+                child->QueryInternal(QueryObject, Callback);
+            }
+        }
+    }
+
+    void GetBoundariesInternal(std::vector<TBoundary>& result) const {
+        result.push_back(LooseBoundaryData);
+        for (const auto& child : Children) {
+            if (child) {
+                child->GetBoundariesInternal(result);
+            }
+        }
+    }
+
+    std::array<std::unique_ptr<LooseOctreeCpp<TVector, TData>>, NrSections<TVector>()> Children;
+    std::vector<TBoundaryWrapper> Data;
+    TBoundary BoundaryData;
+    TBoundary LooseBoundaryData;
+    float Looseness;
+    size_t Depth;
+    size_t NrObjects = 0;
+    bool IsSplit = false;
+};
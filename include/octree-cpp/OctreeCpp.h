@@ -2,26 +2,47 @@
 
 #include "OctreeUtil.h"
 #include "OctreeQuery.h"
-#include <memory>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <tuple>
+#include <vector>
+
+template <typename TVector, typename TData>
+requires VectorLike<TVector>
+class FrozenOctreeCpp;
 
 /**
  * A octree implementation with Bring your own vector class depending on what you use
- * in your project. Capabale of storing whatever type of data positioned in 3d space
+ * in your project. Capabale of storing whatever type of data positioned in 2d, 3d or 4d space
  * and support complex queries to find whatever data you are looking for quickly.
  *
  * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
  * @tparam TData Data blob that should be paired up with the added object.
+ * @tparam TKeys Optional functors that extract keys from the payload, every node keeps the min and max of
+ * each key below it so queries with a CoversKeys function, like KeyRange, can skip nodes on the payload.
  */
-template <typename TVector, typename TData>
+template <typename TVector, typename TData, typename... TKeys>
 requires VectorLike<TVector>
 class OctreeCpp {
 private:
     static constexpr size_t MaxData = 8;
-    using Section = std::conditional_t<isVectorLike3D<TVector>(), Octant, Quadrant>;
+    static constexpr size_t MaxDepth = 48;
+    // Nodes at MaxDepth are not split, see GetCapacity, the capacity doubles along the chain below them so it
+    // holds more than 2^32 objects before it is this long.
+    static constexpr size_t MaxChain = 32;
+    static constexpr size_t NrSections = ::NrSections<TVector>();
+    using NodeIndex = uint32_t;
+    static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+    static constexpr bool HasKeys = sizeof...(TKeys) > 0;
+    friend class FrozenOctreeCpp<TVector, TData>;
 
 public:
     using TDataWrapper = DataWrapper<TVector, TData>;
     using TBoundary = Boundary<TVector>;
+    using TKeyBounds = KeyBounds<TData, TKeys...>;
+    using NodeId = NodeIndex;
 
     /**
      * Not query, inverts whatever query it has as input.
@@ -30,7 +51,8 @@ public:
     using Not = NotQuery<TDataWrapper, Query>;
 
     /**
-     * Sphere query, for finding objects within given sphere.
+     * Sphere query, for finding objects within given sphere. With a periodic boundary it does not reach through
+     * the sides of the boundary, use MakePeriodicSphere for that.
      */
     using Sphere = SphereQuery<TDataWrapper>;
 
@@ -44,6 +66,22 @@ public:
      */
     using Cylinder = CylinderQuery<TDataWrapper>;
 
+    /**
+     * Box query, for finding objects within given axis aligned box.
+     */
+    using Box = BoxQuery<TDataWrapper>;
+
+    /**
+     * Key range query, for finding objects where the key TKey extracts from the payload is within a range.
+     */
+    template <typename TKey>
+    using KeyRange = KeyRangeQuery<TDataWrapper, TKey>;
+
+    /**
+     * Periodic sphere query, for finding objects within given sphere in a periodic boundary, see MakePeriodicSphere.
+     */
+    using PeriodicSphere = PeriodicSphereQuery<TDataWrapper>;
+
     /**
      * Predicate query to find based on something specific in
      * either position or the data.
@@ -68,34 +106,122 @@ public:
      * Constructor to setup the Octree.
      *
      * @param Boundary min and max X, Y, Z values of the octree.
+     * @param Split How nodes choose the point they are split at.
+     * @param Bounds What happens when data is added outside of the boundary.
      */
-    explicit OctreeCpp(TBoundary Boundary) : BoundaryData(Boundary) {
-        Data.reserve(MaxData);
+    explicit OctreeCpp(TBoundary Boundary, SplitPolicy Split = SplitPolicy::Midpoint, BoundaryPolicy Bounds = BoundaryPolicy::Fixed)
+        : BoundaryData(Boundary)
+        , Split(Split)
+        , Bounds(Bounds) {
+        if (Bounds == BoundaryPolicy::Periodic && !(BoundaryData.GetVolume() > 0.0f)) {
+            throw std::runtime_error("Periodic boundary must have a size along every axis");
+        }
+        Root = CreateNode(BoundaryData, 0);
+    }
+
+    OctreeCpp(TBoundary Boundary, BoundaryPolicy Bounds)
+        : OctreeCpp(Boundary, SplitPolicy::Midpoint, Bounds) {
+    }
+
+    /**
+     * Stores the given data in the octree container. With a periodic boundary the stored position
+     * is wrapped into the boundary.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) requires std::copy_constructible<TData> {
+        if (Bounds == BoundaryPolicy::Periodic) {
+            Add(TDataWrapper(DataWrapper));
+            return;
+        }
+        NodePath path;
+        auto& data = LocateLeaf(DataWrapper.Vector, path);
+        data.push_back(DataWrapper);
+        CountAdded(path, data.back().Data);
     }
 
     /**
-     * Stores the given data in the octree container.
+     * Stores the given data in the octree container, moves the payload instead of copying it.
      * @param DataWrapper
      */
-    void Add(const TDataWrapper& DataWrapper) {
-        if (!IsPointInBoundrary(DataWrapper.Vector, BoundaryData)) {
-            throw std::runtime_error("Vector is outside of boundary");
+    void Add(TDataWrapper&& DataWrapper) {
+        if (Bounds == BoundaryPolicy::Periodic) {
+            DataWrapper.Vector = WrapPoint(DataWrapper.Vector, BoundaryData);
         }
+        NodePath path;
+        auto& data = LocateLeaf(DataWrapper.Vector, path);
+        data.push_back(std::move(DataWrapper));
+        CountAdded(path, data.back().Data);
+    }
 
-        if (Data.size() < MaxData) {
-            Data.push_back(DataWrapper);
-            if (!ValidateInvariant()) {
-                throw std::runtime_error("Invariant is broken");
+    /**
+     * Stores all the given data, the result is the same tree as adding the data one at a time in order.
+     * The batch is split by the sections of every node it passes, so every node is only visited once per
+     * batch instead of once per object. The subtrees of the children of the root are filled as separate
+     * tasks, with Parallel they run on several threads.
+     * Throws without adding anything if data is outside of a fixed boundary, with a growing boundary data
+     * outside of it is added one at a time. The tree is only changed after all tasks are done, so a task that
+     * throws leaves the tree as it was.
+     *
+     * @param Data The data to add.
+     * @param Parallel Fills the subtrees of the root on several threads.
+     */
+    void AddBatch(std::span<const TDataWrapper> Data, bool Parallel = false) requires std::copy_constructible<TData> {
+        std::vector<TDataWrapper> items(Data.begin(), Data.end());
+        for (auto& item : items) {
+            if (Bounds == BoundaryPolicy::Periodic) {
+                item.Vector = WrapPoint(item.Vector, BoundaryData);
+            } else if (!IsPointInBoundrary(item.Vector, BoundaryData)) {
+                if (Bounds != BoundaryPolicy::Grow) {
+                    throw std::runtime_error("Vector is outside of boundary");
+                }
+                for (auto& data : items) {
+                    Add(std::move(data));
+                }
+                return;
             }
-            NrObjects++;
-            return;
         }
-        Section section = LocateOctant(DataWrapper.Vector, BoundaryData.GetMidpoint());
-        if (!HasChild(section)) {
-            CreateChild(section);
+        if (items.size() >= NoNode) {
+            throw std::runtime_error("Too much data in batch");
         }
-        AddToChild(section, DataWrapper);
-        NrObjects++;
+        std::vector<NodeIndex> ids(items.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            ids[i] = static_cast<NodeIndex>(i);
+        }
+
+        // The last arena is for the root, the others for the subtrees of its children.
+        std::vector<BatchArena> arenas(NrSections + 1);
+        auto groups = DistributeBatch(Root, false, BoundaryData, 0, ids, items, arenas.back());
+        std::vector<std::function<void()>> tasks;
+        for (size_t section = 0; section < NrSections; section++) {
+            if (!groups.Ids[section].empty()) {
+                tasks.emplace_back([&, section]() {
+                    InsertBatchInChild(Root, false, BoundaryData, groups.Split, section, 1, groups.Ids[section], items, arenas[section]);
+                });
+            }
+        }
+        RunTasks(tasks, Parallel);
+        MergeBatchArenas(arenas, items);
+        NrObjects += items.size();
+    }
+
+    /**
+     * Constructs the payload in place in the node where it is stored.
+     *
+     * @param Position Position of the data.
+     * @param Args Arguments forwarded to the constructor of TData.
+     * @return The stored data.
+     */
+    template <typename... TArgs>
+    requires std::constructible_from<TData, TArgs...>
+    const TDataWrapper& Emplace(const TVector& Position, TArgs&&... Args) {
+        auto position = Bounds == BoundaryPolicy::Periodic ? WrapPoint(Position, BoundaryData) : Position;
+        NodePath path;
+        auto& data = LocateLeaf(position, path);
+        data.emplace_back(position, DeferredConstruct{[&]() {
+            return TData(std::forward<TArgs>(Args)...);
+        }});
+        CountAdded(path, data.back().Data);
+        return data.back();
     }
 
     /**
@@ -107,12 +233,65 @@ public:
      * @return A vector of results.
      */
     template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
     [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) const {
         std::vector<TDataWrapper> result;
-        QueryInternal(QueryObject, result);
+        QueryInternal(QueryObject, [&result](const TDataWrapper& Data) {
+            result.push_back(Data);
+        });
+        return result;
+    }
+
+    /**
+     * Queries the octree and returns references to the stored data instead of copies,
+     * works for payloads that are large or can't be copied.
+     * The references stays valid for the lifetime of the octree, adding more data does not move stored data,
+     * also when many duplicates of one point are added, see GetCapacity.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of references to the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<std::reference_wrapper<const TDataWrapper>> QueryRefs(const TQueryObject& QueryObject) const {
+        std::vector<std::reference_wrapper<const TDataWrapper>> result;
+        QueryInternal(QueryObject, [&result](const TDataWrapper& Data) {
+            result.push_back(std::cref(Data));
+        });
         return result;
     }
 
+    template <IsQuery<TDataWrapper> TQueryObject>
+    class QueryView;
+
+    /**
+     * Queries the octree lazily, the results are found while they are pulled from the returned view.
+     * Works with the standard range adaptors, for example std::views::take to only find the first results.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A view over the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] QueryView<TQueryObject> QueryRange(const TQueryObject& QueryObject) const {
+        return {this, QueryObject};
+    }
+
+    template <IsQuery<TDataWrapper> TQueryObject>
+    class QueryCursor;
+
+    /**
+     * Creates a cursor for queries that move a little at a time, see QueryCursor.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The first query of the cursor.
+     * @return The cursor with the results of the first query.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] QueryCursor<TQueryObject> CreateCursor(const TQueryObject& QueryObject) const {
+        return QueryCursor<TQueryObject>(this, QueryObject);
+    }
+
     /**
      * @return Number of object in container.
      */
@@ -120,79 +299,1313 @@ public:
         return NrObjects;
     }
 
+    /**
+     * @return The boundary of the root of the octree.
+     */
+    [[nodiscard]] const TBoundary& GetBoundary() const {
+        return BoundaryData;
+    }
+
+    /**
+     * @param Midpoint Center of the sphere.
+     * @param Radius Radius of the sphere.
+     * @return A sphere query that also finds the data through the sides of the boundary of the octree.
+     */
+    [[nodiscard]] PeriodicSphere MakePeriodicSphere(const TVector& Midpoint, float Radius) const {
+        return PeriodicSphere{Midpoint, Radius, BoundaryData};
+    }
+
     /**
      * @return The boundraries of the octree.
      */
-     [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
         std::vector<TBoundary> result;
-        result.push_back(BoundaryData);
-        for (const auto& child : Children) {
-            if (child) {
-                auto childBoundaries = child->GetBoundaries();
-                for (auto & childchild : childBoundaries) {
-                    result.push_back(childchild);
+        result.reserve(Nodes.size());
+        VisitNodes([&result](const NodeInfo& Info) {
+            result.push_back(Info.Bound);
+        });
+        return result;
+    }
+
+    /**
+     * What VisitNodes reports about a node.
+     */
+    struct NodeInfo {
+        NodeId Id;
+        TBoundary Bound;
+        size_t Depth;
+        /** Number of objects in the node and all nodes below it. */
+        size_t NrObjects;
+        /** Number of objects stored in the node itself. */
+        size_t NrData;
+        bool IsLeaf;
+    };
+
+    /**
+     * Visits every node depth first starting with the root, without allocating. If the visitor
+     * returns a bool the children of a node are only visited when it returns true, so whole
+     * subtrees can be skipped. A visitor that returns void visits all nodes.
+     *
+     * @tparam TVisitor Callable with a const NodeInfo&.
+     * @param Visitor Called once for every visited node.
+     */
+    template <typename TVisitor>
+    requires std::invocable<TVisitor&, const NodeInfo&>
+    void VisitNodes(TVisitor&& Visitor) const {
+        TraversalStack stack;
+        stack.push(GetRoot());
+        while (!stack.empty()) {
+            auto ref = stack.pop();
+            const auto& node = Nodes[ref.Index];
+            NodeInfo info{ref.Index, ref.Bound, ref.Depth, node.NrObjects, DataBlocks[ref.Index].size(), !HasChildren(ref.Index)};
+            if constexpr (std::is_same_v<std::invoke_result_t<TVisitor&, const NodeInfo&>, void>) {
+                Visitor(info);
+            } else if (!Visitor(info)) {
+                continue;
+            }
+            PushChildren(ref, stack, [](const NodeRef&) {
+                return true;
+            });
+        }
+    }
+
+    /**
+     * Level of detail query that returns at most Budget results spread out over the query.
+     * The tree is traversed breadth first and every node keeps the first data that was added to its
+     * region, so the data of the top levels is a sample of all data below them. Levels are added while
+     * they fit in the budget, the last level that doesn't fit is sampled evenly by taking one result
+     * from every node in turn. The cost depends on the budget and not on the amount of data.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @param Budget Max number of results.
+     * @param MaxLevel Nodes deeper than this are not visited, the root is level 0.
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TDataWrapper> QueryLod(const TQueryObject& QueryObject, size_t Budget, size_t MaxLevel = MaxDepth + MaxChain) const {
+        std::vector<TDataWrapper> result;
+        std::vector<NodeRef> level{GetRoot()};
+        std::vector<NodeRef> next;
+        std::vector<std::vector<const TDataWrapper*>> hits;
+        for (size_t depth = 0; depth <= MaxLevel && !level.empty() && result.size() < Budget; depth++) {
+            hits.resize(level.size());
+            size_t nrHits = 0;
+            for (size_t i = 0; i < level.size(); i++) {
+                hits[i].clear();
+                for (const auto& data : DataBlocks[level[i].Index]) {
+                    if (QueryObject.IsInside(data)) {
+                        hits[i].push_back(&data);
+                    }
+                }
+                nrHits += hits[i].size();
+            }
+            if (result.size() + nrHits > Budget) {
+                for (size_t round = 0; result.size() < Budget; round++) {
+                    for (size_t i = 0; i < level.size() && result.size() < Budget; i++) {
+                        if (round < hits[i].size()) {
+                            result.push_back(*hits[i][round]);
+                        }
+                    }
                 }
+                break;
             }
+            next.clear();
+            for (size_t i = 0; i < level.size(); i++) {
+                for (auto hit : hits[i]) {
+                    result.push_back(*hit);
+                }
+                for (const auto& child : GetChildren(level[i])) {
+                    if (CoversNode(QueryObject, child)) {
+                        next.push_back(child);
+                    }
+                }
+            }
+            std::swap(level, next);
+        }
+        return result;
+    }
+
+    /**
+     * Counts the data in a grid of Resolution cells along every axis that covers Region, without
+     * visiting the data. Along every axis a cell includes its upper edge but not its lower edge,
+     * except the first cell that includes both. Nodes that are fully inside one cell are counted from the number of objects
+     * in the node, so the cost depends on the number of nodes along the cell edges and not on the
+     * amount of data.
+     *
+     * @param Region The boundary that the grid covers, data outside of it is not counted.
+     * @param Resolution Number of cells along every axis.
+     * @return The count of every cell, the cell (x, y, z) is at x + y * Resolution + z * Resolution^2.
+     */
+    [[nodiscard]] std::vector<size_t> Histogram(const TBoundary& Region, size_t Resolution) const {
+        CellGrid grid(Region, Resolution);
+        std::vector<size_t> result(grid.NrCells, 0);
+        auto root = GetRoot();
+        if (auto cell = grid.GetCell(root.Bound, GetClosedMin(root.Bound))) {
+            result[*cell] += Nodes[root.Index].NrObjects;
+            return result;
         }
+        Traverse([&](const NodeRef& Child) {
+            if (DistanceSquared(Child.Bound, Region) > 0.0f) {
+                return false;
+            }
+            if (auto cell = grid.GetCell(Child.Bound, GetClosedMin(Child.Bound))) {
+                result[*cell] += Nodes[Child.Index].NrObjects;
+                return false;
+            }
+            return true;
+        }, [&](const NodeRef& Node) {
+            for (const auto& data : DataBlocks[Node.Index]) {
+                if (auto cell = grid.GetCell(data.Vector)) {
+                    result[*cell]++;
+                }
+            }
+        });
         return result;
     }
 
+    /**
+     * Aggregates the data in a grid of Resolution cells along every axis that covers Region, every
+     * cell starts as Init and Accumulate is called with the cell value and every data in the cell.
+     * Only the nodes that overlap Region are visited and no data is copied.
+     *
+     * @param Region The boundary that the grid covers, data outside of it is skipped.
+     * @param Resolution Number of cells along every axis.
+     * @param Init Initial value of every cell.
+     * @param Accumulate Called as Accumulate(TValue&, const TDataWrapper&).
+     * @return The value of every cell, the cell (x, y, z) is at x + y * Resolution + z * Resolution^2.
+     */
+    template <typename TValue, typename TAccumulate>
+    [[nodiscard]] std::vector<TValue> Voxelize(const TBoundary& Region, size_t Resolution, const TValue& Init, TAccumulate&& Accumulate) const {
+        CellGrid grid(Region, Resolution);
+        std::vector<TValue> result(grid.NrCells, Init);
+        Traverse([&](const NodeRef& Child) {
+            return DistanceSquared(Child.Bound, Region) <= 0.0f;
+        }, [&](const NodeRef& Node) {
+            for (const auto& data : DataBlocks[Node.Index]) {
+                if (auto cell = grid.GetCell(data.Vector)) {
+                    Accumulate(result[*cell], data);
+                }
+            }
+        });
+        return result;
+    }
+
+    /**
+     * Copies the octree into an immutable layout that is faster to query, see FrozenOctreeCpp.
+     * @return The frozen octree.
+     */
+    [[nodiscard]] FrozenOctreeCpp<TVector, TData> Freeze() const& requires std::copy_constructible<TData> && (!HasKeys) {
+        return FrozenOctreeCpp<TVector, TData>(*this);
+    }
+
+    /**
+     * Moves the data of the octree into an immutable layout that is faster to query, see FrozenOctreeCpp.
+     * @return The frozen octree.
+     */
+    [[nodiscard]] FrozenOctreeCpp<TVector, TData> Freeze() && requires (!HasKeys) {
+        return FrozenOctreeCpp<TVector, TData>(std::move(*this));
+    }
+
+    /**
+     * Calls Callback once for every unordered pair of objects that are within Radius of each other.
+     * Recurses node pair by node pair and skips node pairs whose boundaries are further apart than Radius.
+     * With a periodic boundary the distance is measured between the closest images of the objects.
+     *
+     * @param Radius Max distance between the objects in a pair.
+     * @param Callback Called with the two objects of each pair.
+     * @param Parallel Spreads the top level node pairs over several threads, Callback is then called concurrently.
+     */
+    template <typename TCallback>
+    void ForEachPairWithin(float Radius, TCallback&& Callback, bool Parallel = false) const {
+        std::vector<std::function<void()>> tasks;
+        PairRange range{Radius * Radius, Bounds == BoundaryPolicy::Periodic ? &BoundaryData : nullptr};
+        auto root = GetRoot();
+        auto children = GetChildren(root);
+        tasks.emplace_back([&]() {
+            const auto& data = DataBlocks[root.Index];
+            PairsWithinData(data, range, Callback);
+            for (const auto& child : children) {
+                if (!data.empty()) {
+                    PairsWithTree(data, GetBoundaryOf(data), *this, child, range, true, Callback);
+                }
+            }
+        });
+        for (size_t i = 0; i < children.size(); i++) {
+            tasks.emplace_back([&, i]() {
+                PairsWithinTree(children[i], range, Callback);
+            });
+            for (size_t j = i + 1; j < children.size(); j++) {
+                tasks.emplace_back([&, i, j]() {
+                    PairsBetweenTrees(*this, children[i], *this, children[j], range, Callback);
+                });
+            }
+        }
+        RunTasks(tasks, Parallel);
+    }
+
+    /**
+     * Calls Callback once for every pair of one object in this octree and one object in Other
+     * that are within Radius of each other. Periodic octrees can only be joined with periodic octrees
+     * with the same boundary, the distance is then measured between the closest images.
+     *
+     * @param Other The other octree.
+     * @param Radius Max distance between the objects in a pair.
+     * @param Callback Called with the object from this octree first and the object from Other second.
+     * @param Parallel Spreads the top level node pairs over several threads, Callback is then called concurrently.
+     */
+    template <typename TCallback>
+    void ForEachPairWithin(const OctreeCpp& Other, float Radius, TCallback&& Callback, bool Parallel = false) const {
+        std::vector<std::function<void()>> tasks;
+        bool periodic = Bounds == BoundaryPolicy::Periodic;
+        if (periodic != (Other.Bounds == BoundaryPolicy::Periodic) ||
+            (periodic && (ToArray(BoundaryData.Min) != ToArray(Other.BoundaryData.Min) || ToArray(BoundaryData.Max) != ToArray(Other.BoundaryData.Max)))) {
+            throw std::runtime_error("Periodic octrees can only be joined with octrees with the same periodic boundary");
+        }
+        PairRange range{Radius * Radius, periodic ? &BoundaryData : nullptr};
+        if (!range.IsNear(BoundaryData, Other.BoundaryData)) {
+            return;
+        }
+        auto root = GetRoot();
+        auto otherRoot = Other.GetRoot();
+        auto children = GetChildren(root);
+        auto otherChildren = Other.GetChildren(otherRoot);
+        tasks.emplace_back([&]() {
+            const auto& data = DataBlocks[root.Index];
+            const auto& otherData = Other.DataBlocks[otherRoot.Index];
+            PairsBetweenData(data, otherData, range, Callback);
+            for (const auto& child : otherChildren) {
+                if (!data.empty()) {
+                    PairsWithTree(data, GetBoundaryOf(data), Other, child, range, true, Callback);
+                }
+            }
+            for (const auto& child : children) {
+                if (!otherData.empty()) {
+                    PairsWithTree(otherData, GetBoundaryOf(otherData), *this, child, range, false, Callback);
+                }
+            }
+        });
+        for (const auto& child : children) {
+            for (const auto& otherChild : otherChildren) {
+                tasks.emplace_back([&]() {
+                    PairsBetweenTrees(*this, child, Other, otherChild, range, Callback);
+                });
+            }
+        }
+        RunTasks(tasks, Parallel);
+    }
+
 private:
+    /**
+     * A node in the octree, the boundary of the node is not stored but computed from the root
+     * boundary and the split points on the way down. Children refers to other nodes by index
+     * so nodes are trivially copyable and packed in one array, the data of a node is stored
+     * in DataBlocks at the same index as the node.
+     */
+    struct Node {
+        std::array<NodeIndex, NrSections> Children;
+        uint32_t NrObjects = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<Node>);
+
+    /**
+     * A node together with its boundary, computed while traversing the tree.
+     */
+    struct NodeRef {
+        NodeIndex Index = NoNode;
+        TBoundary Bound;
+        uint32_t Depth = 0;
+    };
+
+    /**
+     * The existing children of a node, without allocating.
+     */
+    struct ChildRefs {
+        std::array<NodeRef, NrSections> Refs;
+        size_t Count = 0;
+
+        [[nodiscard]] size_t size() const { return Count; }
+        const NodeRef& operator[](size_t Index) const { return Refs[Index]; }
+        auto begin() const { return Refs.begin(); }
+        auto end() const { return Refs.begin() + Count; }
+    };
+
+    /**
+     * The nodes left to visit in a depth first traversal. Every level adds at most NrSections - 1
+     * nodes more than it removes, so the stack can't grow beyond this size since the depth is capped.
+     * The chains below MaxDepth only have one child per node so they don't add to it.
+     */
+    struct TraversalStack {
+        std::array<NodeRef, MaxDepth * (NrSections - 1) + 1> Refs;
+        size_t Count = 0;
+
+        [[nodiscard]] bool empty() const { return Count == 0; }
+        void push(const NodeRef& Ref) { Refs[Count++] = Ref; }
+        NodeRef pop() { return Refs[--Count]; }
+    };
+
+public:
+    /**
+     * A lazy query, the octree is traversed while the results are pulled from it, using a fixed
+     * size stack that is part of the view so no allocations are done while iterating. Results are produced in the
+     * same order as Query. Iterating the view again continues where the last iteration stopped, so it
+     * can be used for pagination with std::ranges::ref_view and std::views::take. The view is only valid as long as the octree
+     * is not modified.
+     *
+     * @tparam TQueryObject The query type.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    class QueryView : public std::ranges::view_interface<QueryView<TQueryObject>> {
+    public:
+        class Iterator {
+        public:
+            using value_type = TDataWrapper;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+            explicit Iterator(QueryView* View)
+                : View(View) {
+            }
+
+            const TDataWrapper& operator*() const {
+                return *View->Current;
+            }
+
+            const TDataWrapper* operator->() const {
+                return View->Current;
+            }
+
+            Iterator& operator++() {
+                View->Next();
+                return *this;
+            }
+
+            void operator++(int) {
+                View->Next();
+            }
+
+            friend bool operator==(const Iterator& It, std::default_sentinel_t) {
+                return It.AtEnd();
+            }
+
+        private:
+            bool AtEnd() const {
+                return View->Current == nullptr;
+            }
+
+            QueryView* View = nullptr;
+        };
+
+        QueryView() = default;
+        QueryView(const OctreeCpp* Octree, const TQueryObject& QueryObject)
+            : Octree(Octree)
+            , QueryObject(QueryObject) {
+        }
+
+        QueryView(QueryView&&) = default;
+        QueryView& operator=(QueryView&& Other) {
+            if (this != &Other) {
+                Octree = Other.Octree;
+                QueryObject.reset();
+                if (Other.QueryObject) {
+                    QueryObject.emplace(std::move(*Other.QueryObject));
+                }
+                Stack = Other.Stack;
+                Node = Other.Node;
+                Position = Other.Position;
+                Current = Other.Current;
+                Started = Other.Started;
+            }
+            return *this;
+        }
+
+        Iterator begin() {
+            if (!Started) {
+                Started = true;
+                Node = Octree->GetRoot();
+                Next();
+            }
+            return Iterator(this);
+        }
+
+        std::default_sentinel_t end() const {
+            return std::default_sentinel;
+        }
+
+    private:
+        void Next() {
+            while (true) {
+                const auto& data = Octree->DataBlocks[Node.Index];
+                while (Position < data.size()) {
+                    const auto& wrapper = data[Position++];
+                    if (QueryObject->IsInside(wrapper)) {
+                        Current = &wrapper;
+                        return;
+                    }
+                }
+                Octree->PushChildren(Node, Stack, [this](const NodeRef& Child) {
+                    return Octree->CoversNode(*QueryObject, Child);
+                });
+                if (Stack.empty()) {
+                    Current = nullptr;
+                    return;
+                }
+                Node = Stack.pop();
+                Octree->PrefetchData(Node.Index);
+                Position = 0;
+            }
+        }
+
+        const OctreeCpp* Octree = nullptr;
+        std::optional<TQueryObject> QueryObject;
+        TraversalStack Stack;
+        NodeRef Node;
+        size_t Position = 0;
+        const TDataWrapper* Current = nullptr;
+        bool Started = false;
+    };
+
+    /**
+     * A query that is updated incrementally when it moves a little at a time, like the view of an agent
+     * every tick. The cursor keeps the path from the root down to the deepest node that contains the
+     * bounds of the query. On Update it only climbs that path as far as needed to contain the new bounds
+     * and traverses from there instead of from the root, and it reports the nodes the query entered and
+     * exited since the last update. Queries without GetQueryBounds always traverse from the root.
+     * The cursor stays valid when data is added to the octree.
+     *
+     * @tparam TQueryObject The query type.
+     */
     template <IsQuery<TDataWrapper> TQueryObject>
-    void QueryInternal(const TQueryObject& QueryObject, std::vector<TDataWrapper>& result) const {
-        for (const auto& data : Data) {
-            if (QueryObject.IsInside(data)) {
-                result.push_back(data);
+    class QueryCursor {
+    public:
+        QueryCursor(const OctreeCpp* Octree, const TQueryObject& QueryObject)
+            : Octree(Octree) {
+            Update(QueryObject);
+        }
+
+        /**
+         * Moves the cursor to the new query and updates the results.
+         * @param QueryObject
+         */
+        void Update(const TQueryObject& QueryObject) {
+            if (Path.empty() || Path.front().Index != Octree->Root) {
+                Path.assign(1, Octree->GetRoot());
+            }
+            if constexpr (HasQueryBounds<TQueryObject, TDataWrapper>) {
+                auto bounds = GetQueryBounds(QueryObject);
+                while (Path.size() > 1 && !Contains(Path.back().Bound, bounds)) {
+                    Path.pop_back();
+                }
+                for (bool descended = true; descended;) {
+                    descended = false;
+                    for (const auto& child : Octree->GetChildren(Path.back())) {
+                        if (Contains(child.Bound, bounds)) {
+                            Path.push_back(child);
+                            descended = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            Results.clear();
+            std::swap(Visited, Previous);
+            Visited.clear();
+            for (size_t i = 0; i + 1 < Path.size(); i++) {
+                AddResults(Path[i].Index, QueryObject);
+                Visited.push_back(Path[i].Index);
+            }
+            Octree->Traverse(Path.back(), [this, &QueryObject](const NodeRef& Child) {
+                return Octree->CoversNode(QueryObject, Child);
+            }, [&](const NodeRef& Node) {
+                AddResults(Node.Index, QueryObject);
+                Visited.push_back(Node.Index);
+            });
+
+            std::sort(Visited.begin(), Visited.end());
+            EnteredNodes.clear();
+            ExitedNodes.clear();
+            std::set_difference(Visited.begin(), Visited.end(), Previous.begin(), Previous.end(), std::back_inserter(EnteredNodes));
+            std::set_difference(Previous.begin(), Previous.end(), Visited.begin(), Visited.end(), std::back_inserter(ExitedNodes));
+        }
+
+        /**
+         * @return The results of the last query, in the same order as QueryRefs.
+         */
+        [[nodiscard]] const std::vector<std::reference_wrapper<const TDataWrapper>>& GetResults() const {
+            return Results;
+        }
+
+        /**
+         * @return The nodes that the last query visited, sorted.
+         */
+        [[nodiscard]] const std::vector<NodeId>& GetNodes() const {
+            return Visited;
+        }
+
+        /**
+         * @return The nodes that the last query visited that the query before it did not, sorted.
+         */
+        [[nodiscard]] const std::vector<NodeId>& GetEnteredNodes() const {
+            return EnteredNodes;
+        }
+
+        /**
+         * @return The nodes that the query before the last visited that the last query did not, sorted.
+         */
+        [[nodiscard]] const std::vector<NodeId>& GetExitedNodes() const {
+            return ExitedNodes;
+        }
+
+        /**
+         * @return Depth of the node the last query was traversed from, the root is 0.
+         */
+        [[nodiscard]] size_t GetAnchorDepth() const {
+            return Path.size() - 1;
+        }
+
+    private:
+        /**
+         * If all data inside of the bounds is stored in the node or below it. Data on a split point is
+         * stored in the lower section, so the bounds needs to be strictly above the min side of the node
+         * unless it is the min side of the root. When the root has grown the old root keeps the data on
+         * its min side, so data on any side of a node can be stored in a neighbour and the bounds needs to
+         * be strictly inside of the node.
+         */
+        bool Contains(const TBoundary& Node, const TBoundary& Bounds) const {
+            auto closedMin = Octree->GetClosedMin(Node);
+            bool grown = Octree->Bounds == BoundaryPolicy::Grow;
+            return AllAxes<TBoundary::Dim>([&](auto Axis) {
+                if (grown) {
+                    return GetAxis<Axis>(Bounds.Min) > GetAxis<Axis>(Node.Min) && GetAxis<Axis>(Bounds.Max) < GetAxis<Axis>(Node.Max);
+                }
+                bool aboveMin = closedMin[Axis] ? GetAxis<Axis>(Bounds.Min) >= GetAxis<Axis>(Node.Min) : GetAxis<Axis>(Bounds.Min) > GetAxis<Axis>(Node.Min);
+                return aboveMin && GetAxis<Axis>(Bounds.Max) <= GetAxis<Axis>(Node.Max);
+            });
+        }
+
+        void AddResults(NodeIndex Index, const TQueryObject& QueryObject) {
+            for (const auto& data : Octree->DataBlocks[Index]) {
+                if (QueryObject.IsInside(data)) {
+                    Results.push_back(std::cref(data));
+                }
+            }
+        }
+
+        const OctreeCpp* Octree = nullptr;
+        std::vector<NodeRef> Path;
+        std::vector<std::reference_wrapper<const TDataWrapper>> Results;
+        std::vector<NodeId> Visited;
+        std::vector<NodeId> Previous;
+        std::vector<NodeId> EnteredNodes;
+        std::vector<NodeId> ExitedNodes;
+    };
+
+private:
+    [[nodiscard]] NodeRef GetRoot() const {
+        return {Root, BoundaryData};
+    }
+
+    [[nodiscard]] bool StoresSplitPoints() const {
+        return Split == SplitPolicy::Median || Bounds == BoundaryPolicy::Grow;
+    }
+
+    /**
+     * Nodes at MaxDepth and below are split at their max corner, so their only child is in section 0 and
+     * has the same boundary, see GetCapacity.
+     */
+    [[nodiscard]] TVector GetSplitPoint(const NodeRef& Ref) const {
+        if (Ref.Depth >= MaxDepth) {
+            return Ref.Bound.Max;
+        }
+        return SplitPoints.empty() ? Ref.Bound.GetMidpoint() : SplitPoints[Ref.Index];
+    }
+
+    /**
+     * Number of objects the node stores before the data continues in its children, MaxData above MaxDepth.
+     * Nodes at MaxDepth are never split, which only happens for many duplicates of the same point, when
+     * one is full the data continues in a chain of children with the same boundary and twice the capacity.
+     * Data is never added beyond the reserved capacity of a node, also in copies of the octree where it can be
+     * smaller, so stored data never moves.
+     */
+    [[nodiscard]] static size_t GetCapacity(const std::vector<TDataWrapper>& Data, size_t NodeDepth) {
+        return NodeDepth < MaxDepth ? std::min(MaxData, Data.capacity()) : Data.capacity();
+    }
+
+    /**
+     * @return The capacity reserved for a new node at the depth.
+     */
+    [[nodiscard]] static size_t GetReserve(size_t NodeDepth) {
+        return NodeDepth <= MaxDepth ? MaxData : MaxData << (NodeDepth - MaxDepth);
+    }
+
+    [[nodiscard]] ChildRefs GetChildren(const NodeRef& Parent) const {
+        ChildRefs result;
+        const auto& node = Nodes[Parent.Index];
+        auto split = GetSplitPoint(Parent);
+        for (size_t i = 0; i < NrSections; i++) {
+            if (node.Children[i] != NoNode) {
+                result.Refs[result.Count++] = {node.Children[i], GetBoundaryFromSection(i, Parent.Bound, split), Parent.Depth + 1};
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] bool HasChildren(NodeIndex Index) const {
+        for (auto child : Nodes[Index].Children) {
+            if (child != NoNode) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    NodeIndex CreateNode(const TBoundary& Bound, size_t NodeDepth) {
+        if (Nodes.size() >= NoNode) {
+            throw std::runtime_error("Too many nodes");
+        }
+        Node node;
+        node.Children.fill(NoNode);
+        Nodes.push_back(node);
+        DataBlocks.emplace_back().reserve(GetReserve(NodeDepth));
+        if (StoresSplitPoints()) {
+            SplitPoints.push_back(Bound.GetMidpoint());
+        }
+        if constexpr (HasKeys) {
+            NodeKeys.emplace_back();
+        }
+        return static_cast<NodeIndex>(Nodes.size() - 1);
+    }
+
+    /**
+     * The nodes on the way to the node that data is added to, they are only counted once the data
+     * is stored so a payload constructor that throws leaves the counts as they were.
+     */
+    struct NodePath {
+        std::array<NodeIndex, MaxDepth + MaxChain + 1> Nodes;
+        size_t Count = 0;
+    };
+
+    void CountAdded(const NodePath& Path, const TData& Data) {
+        for (size_t i = 0; i < Path.Count; i++) {
+            Nodes[Path.Nodes[i]].NrObjects++;
+            if constexpr (HasKeys) {
+                NodeKeys[Path.Nodes[i]].Extend(Data);
+            }
+        }
+        NrObjects++;
+    }
+
+    /**
+     * @return If the query can hit any data in the node, based on its boundary and on its key bounds.
+     */
+    template <typename TQueryObject>
+    [[nodiscard]] bool CoversNode(const TQueryObject& QueryObject, const NodeRef& Node) const {
+        if constexpr (HasKeys) {
+            if (!QueryCoversKeys(QueryObject, NodeKeys[Node.Index])) {
+                return false;
+            }
+        }
+        return QueryObject.Covers(Node.Bound);
+    }
+
+    /**
+     * Changes to a node in the tree from adding a batch: Ids is the data that passes the node and
+     * the first NrStays of them are stored in it.
+     */
+    struct BatchEdit {
+        NodeIndex Index;
+        std::span<const NodeIndex> Ids;
+        size_t NrStays;
+        std::optional<TVector> SplitPoint;
+    };
+
+    /**
+     * Nodes created while adding a batch. A task can't add nodes to the tree while other tasks are
+     * reading it, so the new nodes are kept here and moved into the tree after all tasks are done.
+     * Children of new nodes are indices in the arena, Links are new children of nodes in the tree.
+     * Nodes in the tree are not changed until all tasks are done either, their changes are kept in Edits
+     * so a task that throws leaves the tree as it was.
+     */
+    struct BatchArena {
+        std::vector<Node> Nodes;
+        std::vector<std::vector<TDataWrapper>> DataBlocks;
+        std::vector<TVector> SplitPoints;
+        std::vector<TKeyBounds> NodeKeys;
+        std::vector<std::tuple<NodeIndex, size_t, NodeIndex>> Links;
+        std::vector<BatchEdit> Edits;
+        size_t Depth = 0;
+    };
+
+    struct BatchGroups {
+        std::array<std::span<NodeIndex>, NrSections> Ids;
+        TVector Split;
+    };
+
+    /**
+     * Stores the first data of the batch in the node until it is full, in the same way as Add, and
+     * sorts the rest by the section of the node it belongs to while keeping the order.
+     */
+    BatchGroups DistributeBatch(NodeIndex Index, bool InArena, const TBoundary& Bound, size_t NodeDepth, std::span<NodeIndex> Ids, std::vector<TDataWrapper>& Items, BatchArena& Arena) {
+        const auto& node = InArena ? Arena.Nodes[Index] : Nodes[Index];
+        const auto& data = InArena ? Arena.DataBlocks[Index] : DataBlocks[Index];
+        size_t capacity = GetCapacity(data, NodeDepth);
+        size_t nrStays = std::min(Ids.size(), capacity - std::min(capacity, data.size()));
+        if (InArena) {
+            Arena.Nodes[Index].NrObjects += static_cast<uint32_t>(Ids.size());
+            if constexpr (HasKeys) {
+                for (auto id : Ids) {
+                    Arena.NodeKeys[Index].Extend(Items[id].Data);
+                }
+            }
+            for (size_t i = 0; i < nrStays; i++) {
+                Arena.DataBlocks[Index].push_back(std::move(Items[Ids[i]]));
+            }
+        } else {
+            Arena.Edits.push_back({Index, Ids, nrStays, std::nullopt});
+        }
+        if (nrStays > 0) {
+            Arena.Depth = std::max(Arena.Depth, NodeDepth);
+        }
+
+        BatchGroups groups;
+        auto rest = Ids.subspan(nrStays);
+        if (rest.empty()) {
+            return groups;
+        }
+        bool hasChildren = std::any_of(node.Children.begin(), node.Children.end(), [](NodeIndex Child) {
+            return Child != NoNode;
+        });
+        if (Split == SplitPolicy::Median && NodeDepth < MaxDepth && !hasChildren) {
+            if (InArena) {
+                Arena.SplitPoints[Index] = GetMedianpoint(data, Items[rest[0]].Vector);
+            } else {
+                // The data that stays is not in the node yet.
+                std::vector<TVector> points;
+                points.reserve(data.size() + nrStays + 1);
+                for (const auto& stored : data) {
+                    points.push_back(stored.Vector);
+                }
+                for (size_t i = 0; i <= nrStays; i++) {
+                    points.push_back(Items[Ids[i]].Vector);
+                }
+                Arena.Edits.back().SplitPoint = GetMedianpoint(points);
+            }
+        }
+        if (NodeDepth >= MaxDepth) {
+            groups.Split = Bound.Max;
+        } else if (!StoresSplitPoints()) {
+            groups.Split = Bound.GetMidpoint();
+        } else if (InArena) {
+            groups.Split = Arena.SplitPoints[Index];
+        } else {
+            groups.Split = Arena.Edits.back().SplitPoint.value_or(SplitPoints[Index]);
+        }
+
+        std::array<size_t, NrSections + 1> offsets{};
+        std::vector<NodeIndex> sorted(rest.size());
+        std::vector<uint8_t> sections(rest.size());
+        for (size_t i = 0; i < rest.size(); i++) {
+            sections[i] = static_cast<uint8_t>(LocateSection(Items[rest[i]].Vector, groups.Split));
+            offsets[sections[i] + 1]++;
+        }
+        for (size_t section = 0; section < NrSections; section++) {
+            offsets[section + 1] += offsets[section];
+        }
+        auto next = offsets;
+        for (size_t i = 0; i < rest.size(); i++) {
+            sorted[next[sections[i]]++] = rest[i];
+        }
+        std::copy(sorted.begin(), sorted.end(), rest.begin());
+        for (size_t section = 0; section < NrSections; section++) {
+            groups.Ids[section] = rest.subspan(offsets[section], offsets[section + 1] - offsets[section]);
+        }
+        return groups;
+    }
+
+    void InsertBatchInChild(NodeIndex Parent, bool InArena, const TBoundary& Bound, const TVector& Split, size_t Section, size_t ChildDepth, std::span<NodeIndex> Ids, std::vector<TDataWrapper>& Items, BatchArena& Arena) {
+        auto childBound = GetBoundaryFromSection(Section, Bound, Split);
+        NodeIndex child = (InArena ? Arena.Nodes[Parent] : Nodes[Parent]).Children[Section];
+        bool childInArena = InArena;
+        if (child == NoNode) {
+            child = CreateArenaNode(Arena, childBound, ChildDepth);
+            childInArena = true;
+            if (InArena) {
+                Arena.Nodes[Parent].Children[Section] = child;
+            } else {
+                Arena.Links.emplace_back(Parent, Section, child);
+            }
+        }
+        auto groups = DistributeBatch(child, childInArena, childBound, ChildDepth, Ids, Items, Arena);
+        for (size_t section = 0; section < NrSections; section++) {
+            if (!groups.Ids[section].empty()) {
+                InsertBatchInChild(child, childInArena, childBound, groups.Split, section, ChildDepth + 1, groups.Ids[section], Items, Arena);
+            }
+        }
+    }
+
+    NodeIndex CreateArenaNode(BatchArena& Arena, const TBoundary& Bound, size_t NodeDepth) const {
+        Node node;
+        node.Children.fill(NoNode);
+        Arena.Nodes.push_back(node);
+        Arena.DataBlocks.emplace_back().reserve(GetReserve(NodeDepth));
+        if (StoresSplitPoints()) {
+            Arena.SplitPoints.push_back(Bound.GetMidpoint());
+        }
+        if constexpr (HasKeys) {
+            Arena.NodeKeys.emplace_back();
+        }
+        return static_cast<NodeIndex>(Arena.Nodes.size() - 1);
+    }
+
+    /**
+     * Moves the nodes of the arenas into the tree and applies their edits. Everything that can throw is
+     * done before the tree is changed.
+     */
+    void MergeBatchArenas(std::span<BatchArena> Arenas, std::vector<TDataWrapper>& Items) {
+        size_t nrNodes = Nodes.size();
+        for (const auto& arena : Arenas) {
+            nrNodes += arena.Nodes.size();
+        }
+        if (nrNodes >= NoNode) {
+            throw std::runtime_error("Too many nodes");
+        }
+        Nodes.reserve(nrNodes);
+        DataBlocks.reserve(nrNodes);
+        if (StoresSplitPoints()) {
+            SplitPoints.reserve(nrNodes);
+        }
+        if constexpr (HasKeys) {
+            NodeKeys.reserve(nrNodes);
+        }
+        for (const auto& arena : Arenas) {
+            for (const auto& edit : arena.Edits) {
+                DataBlocks[edit.Index].reserve(DataBlocks[edit.Index].size() + edit.NrStays);
+            }
+        }
+        for (auto& arena : Arenas) {
+            for (const auto& edit : arena.Edits) {
+                Nodes[edit.Index].NrObjects += static_cast<uint32_t>(edit.Ids.size());
+                if constexpr (HasKeys) {
+                    for (auto id : edit.Ids) {
+                        NodeKeys[edit.Index].Extend(Items[id].Data);
+                    }
+                }
+                for (size_t i = 0; i < edit.NrStays; i++) {
+                    DataBlocks[edit.Index].push_back(std::move(Items[edit.Ids[i]]));
+                }
+                if (edit.SplitPoint) {
+                    SplitPoints[edit.Index] = *edit.SplitPoint;
+                }
+            }
+            MergeBatchArena(arena);
+        }
+    }
+
+    void MergeBatchArena(BatchArena& Arena) {
+        auto base = static_cast<NodeIndex>(Nodes.size());
+        for (auto& node : Arena.Nodes) {
+            for (auto& child : node.Children) {
+                if (child != NoNode) {
+                    child += base;
+                }
             }
+            Nodes.push_back(node);
         }
-        if (Data.size() < MaxData) {
+        for (auto& data : Arena.DataBlocks) {
+            DataBlocks.push_back(std::move(data));
+        }
+        SplitPoints.insert(SplitPoints.end(), Arena.SplitPoints.begin(), Arena.SplitPoints.end());
+        NodeKeys.insert(NodeKeys.end(), Arena.NodeKeys.begin(), Arena.NodeKeys.end());
+        for (auto [parent, section, child] : Arena.Links) {
+            Nodes[parent].Children[section] = base + child;
+        }
+        Depth = std::max(Depth, Arena.Depth);
+    }
+
+    /**
+     * How close the objects of a pair have to be, in a periodic boundary measured between the closest images.
+     */
+    struct PairRange {
+        float RadiusSquared;
+        const TBoundary* Period = nullptr;
+
+        bool IsWithin(const TVector& Point1, const TVector& Point2) const {
+            return (Period ? PeriodicDistanceSquared(Point1, Point2, *Period) : DistanceSquared(Point1, Point2)) <= RadiusSquared;
+        }
+
+        bool IsNear(const TBoundary& Bound1, const TBoundary& Bound2) const {
+            return (Period ? PeriodicDistanceSquared(Bound1, Bound2, *Period) : DistanceSquared(Bound1, Bound2)) <= RadiusSquared;
+        }
+    };
+
+    static void RunTasks(const std::vector<std::function<void()>>& Tasks, bool Parallel) {
+        if (Parallel) {
+            ParallelFor(Tasks.size(), [&Tasks](size_t Index) {
+                Tasks[Index]();
+            });
             return;
         }
-        for (const auto& child : Children) {
-            if (child && QueryObject.Covers(child->BoundaryData)) {
-                child->QueryInternal(QueryObject, result);
+        for (const auto& task : Tasks) {
+            task();
+        }
+    }
+
+    template <typename TCallback>
+    static void PairsWithinData(const std::vector<TDataWrapper>& Points, const PairRange& Range, TCallback& Callback) {
+        for (size_t i = 0; i < Points.size(); i++) {
+            for (size_t j = i + 1; j < Points.size(); j++) {
+                if (Range.IsWithin(Points[i].Vector, Points[j].Vector)) {
+                    Callback(Points[i], Points[j]);
+                }
             }
         }
     }
 
-    void CreateChild(Section section) {
-        if (HasChild(section)) {
-            throw std::runtime_error("Child already exists");
+    /**
+     * All pairs within the subtree of Node.
+     */
+    template <typename TCallback>
+    void PairsWithinTree(const NodeRef& Node, const PairRange& Range, TCallback& Callback) const {
+        const auto& data = DataBlocks[Node.Index];
+        PairsWithinData(data, Range, Callback);
+        auto children = GetChildren(Node);
+        for (size_t i = 0; i < children.size(); i++) {
+            if (!data.empty()) {
+                PairsWithTree(data, GetBoundaryOf(data), *this, children[i], Range, true, Callback);
+            }
+            PairsWithinTree(children[i], Range, Callback);
+            for (size_t j = i + 1; j < children.size(); j++) {
+                PairsBetweenTrees(*this, children[i], *this, children[j], Range, Callback);
+            }
+        }
+    }
+
+    template <typename TCallback>
+    static void PairsBetweenData(const std::vector<TDataWrapper>& First, const std::vector<TDataWrapper>& Second, const PairRange& Range, TCallback& Callback) {
+        for (const auto& first : First) {
+            for (const auto& second : Second) {
+                if (Range.IsWithin(first.Vector, second.Vector)) {
+                    Callback(first, second);
+                }
+            }
         }
-        Children.at(static_cast<int>(section)) = std::move(std::make_unique<OctreeCpp<TVector, TData>>(
-                GetBoundraryFromSection(section, BoundaryData)));
     }
 
-    void AddToChild(Section octant, const TDataWrapper& DataWrapper) {
-        int index = static_cast<int>(octant);
-        if (!Children.at(index)) {
-            throw std::runtime_error("Child does not exist");
+    /**
+     * All pairs between the given data and the data in the subtree of Node in Tree.
+     */
+    template <typename TCallback>
+    static void PairsWithTree(const std::vector<TDataWrapper>& Points, const TBoundary& PointsBoundary, const OctreeCpp& Tree, const NodeRef& Node,
+                              const PairRange& Range, bool PointsFirst, TCallback& Callback) {
+        if (!Range.IsNear(PointsBoundary, Node.Bound)) {
+            return;
+        }
+        if (PointsFirst) {
+            PairsBetweenData(Points, Tree.DataBlocks[Node.Index], Range, Callback);
+        } else {
+            PairsBetweenData(Tree.DataBlocks[Node.Index], Points, Range, Callback);
+        }
+        for (const auto& child : Tree.GetChildren(Node)) {
+            PairsWithTree(Points, PointsBoundary, Tree, child, Range, PointsFirst, Callback);
         }
-        Children.at(index)->Add(DataWrapper);
     }
 
-    bool HasChild(Section octant) const {
-        size_t index = static_cast<int>(octant);
-        if (index > Children.size()) {
-            throw std::runtime_error("Invalid octant");
+    /**
+     * All pairs between the data in the subtree of First and the data in the subtree of Second.
+     */
+    template <typename TCallback>
+    static void PairsBetweenTrees(const OctreeCpp& FirstTree, const NodeRef& First, const OctreeCpp& SecondTree, const NodeRef& Second,
+                                  const PairRange& Range, TCallback& Callback) {
+        if (!Range.IsNear(First.Bound, Second.Bound)) {
+            return;
+        }
+        const auto& firstData = FirstTree.DataBlocks[First.Index];
+        const auto& secondData = SecondTree.DataBlocks[Second.Index];
+        auto firstChildren = FirstTree.GetChildren(First);
+        auto secondChildren = SecondTree.GetChildren(Second);
+        PairsBetweenData(firstData, secondData, Range, Callback);
+        for (const auto& child : secondChildren) {
+            if (!firstData.empty()) {
+                PairsWithTree(firstData, GetBoundaryOf(firstData), SecondTree, child, Range, true, Callback);
+            }
+        }
+        for (const auto& child : firstChildren) {
+            if (!secondData.empty()) {
+                PairsWithTree(secondData, GetBoundaryOf(secondData), FirstTree, child, Range, false, Callback);
+            }
+        }
+        for (const auto& child : firstChildren) {
+            for (const auto& otherChild : secondChildren) {
+                PairsBetweenTrees(FirstTree, child, SecondTree, otherChild, Range, Callback);
+            }
+        }
+    }
+
+    /**
+     * Finds the node that the position should be stored in, creating it if needed. The returned data
+     * always has room for one more object without moving, see GetCapacity.
+     * @param Path Filled with the nodes on the way to the node, pass it to CountAdded once the data is stored.
+     * @return The data of the node, only valid until the next node is created.
+     */
+    std::vector<TDataWrapper>& LocateLeaf(const TVector& Position, NodePath& Path) {
+        if (!IsPointInBoundrary(Position, BoundaryData)) {
+            if (Bounds != BoundaryPolicy::Grow) {
+                throw std::runtime_error("Vector is outside of boundary");
+            }
+            GrowTowards(Position);
+        }
+
+        NodeIndex index = Root;
+        TBoundary bound = BoundaryData;
+        size_t depth = 0;
+        while (DataBlocks[index].size() >= GetCapacity(DataBlocks[index], depth)) {
+            if (depth >= MaxDepth + MaxChain) {
+                throw std::runtime_error("Too much data at the same position");
+            }
+            Path.Nodes[Path.Count++] = index;
+            if (Split == SplitPolicy::Median && depth < MaxDepth && !HasChildren(index)) {
+                SplitPoints[index] = GetMedianpoint(DataBlocks[index], Position);
+            }
+            auto split = GetSplitPoint({index, bound, static_cast<uint32_t>(depth)});
+            size_t section = LocateSection(Position, split);
+            bound = GetBoundaryFromSection(section, bound, split);
+            depth++;
+            NodeIndex child = Nodes[index].Children[section];
+            if (child == NoNode) {
+                child = CreateNode(bound, depth);
+                Nodes[index].Children[section] = child;
+            }
+            index = child;
+        }
+        Path.Nodes[Path.Count++] = index;
+        Depth = std::max(Depth, depth);
+#ifndef NDEBUG
+        if ((depth < MaxDepth && !ValidateInvariant(index, bound)) || !IsPointInBoundrary(Position, bound)) {
+            throw std::runtime_error("Invariant is broken");
+        }
+#endif
+        return DataBlocks[index];
+    }
+
+    /**
+     * Pushes the children of the node that Covers returns true for on the stack, in reverse order so
+     * they are popped in section order. The nodes are prefetched so they are in cache when popped.
+     */
+    template <typename TCovers>
+    void PushChildren(const NodeRef& Parent, TraversalStack& Stack, TCovers&& Covers) const {
+        const auto& node = Nodes[Parent.Index];
+        auto split = GetSplitPoint(Parent);
+        for (size_t i = NrSections; i-- > 0;) {
+            NodeIndex child = node.Children[i];
+            if (child == NoNode) {
+                continue;
+            }
+            NodeRef ref{child, GetBoundaryFromSection(i, Parent.Bound, split), Parent.Depth + 1};
+            if (Covers(ref)) {
+                Prefetch(&Nodes[child]);
+                Prefetch(&DataBlocks[child]);
+                Stack.push(ref);
+            }
         }
-        return Children.at(index) != nullptr;
     }
 
-    [[nodiscard]] bool ValidateInvariant() const {
-        if (Data.size() > MaxData) {
+    void PrefetchData(NodeIndex Index) const {
+        Prefetch(DataBlocks[Index].data());
+    }
+
+    /**
+     * Depth first traversal of the tree with an explicit stack, Visit is called for every node
+     * starting with the root and Covers is called for every child to decide if it is visited.
+     */
+    template <typename TCovers, typename TVisit>
+    void Traverse(TCovers&& Covers, TVisit&& Visit) const {
+        Traverse(GetRoot(), Covers, Visit);
+    }
+
+    template <typename TCovers, typename TVisit>
+    void Traverse(const NodeRef& Start, TCovers&& Covers, TVisit&& Visit) const {
+        TraversalStack stack;
+        stack.push(Start);
+        while (!stack.empty()) {
+            auto node = stack.pop();
+            PrefetchData(node.Index);
+            PushChildren(node, stack, Covers);
+            Visit(node);
+        }
+    }
+
+    template <IsQuery<TDataWrapper> TQueryObject, typename TCallback>
+    void QueryInternal(const TQueryObject& QueryObject, TCallback&& Callback) const {
+        Traverse([this, &QueryObject](const NodeRef& Child) {
+            return CoversNode(QueryObject, Child);
+        }, [&](const NodeRef& Node) {
+            for (const auto& data : DataBlocks[Node.Index]) {
+                if (QueryObject.IsInside(data)) {
+                    Callback(data);
+                }
+            }
+        });
+    }
+
+    /**
+     * A grid of Resolution cells along every axis that covers Region. Along every axis the cells are
+     * half open (Edge[i], Edge[i + 1]] except the first that also includes Region.Min, which matches
+     * how data on a split point is put in the lower section of a node.
+     */
+    struct CellGrid {
+        static constexpr size_t Dim = TBoundary::Dim;
+
+        CellGrid(const TBoundary& Region, size_t Resolution)
+            : Resolution(Resolution) {
+            if (Resolution == 0) {
+                throw std::runtime_error("Invalid resolution");
+            }
+            auto min = ToArray(Region.Min);
+            auto max = ToArray(Region.Max);
+            NrCells = 1;
+            for (size_t axis = 0; axis < Dim; axis++) {
+                NrCells *= Resolution;
+                Edges[axis].resize(Resolution + 1);
+                for (size_t i = 0; i < Resolution; i++) {
+                    Edges[axis][i] = min[axis] + (max[axis] - min[axis]) * static_cast<float>(i) / static_cast<float>(Resolution);
+                }
+                Edges[axis][Resolution] = max[axis];
+            }
+        }
+
+        [[nodiscard]] std::optional<size_t> GetAxisCell(size_t Axis, float Value) const {
+            const auto& edges = Edges[Axis];
+            if (!(Value >= edges.front() && Value <= edges.back())) {
+                return std::nullopt;
+            }
+            float cell = (Value - edges.front()) / (edges.back() - edges.front()) * static_cast<float>(Resolution);
+            size_t index = cell > 0.0f ? std::min(static_cast<size_t>(cell), Resolution - 1) : 0;
+            while (index > 0 && Value <= edges[index]) {
+                index--;
+            }
+            while (index + 1 < Resolution && Value > edges[index + 1]) {
+                index++;
+            }
+            return index;
+        }
+
+        [[nodiscard]] std::optional<size_t> GetCell(const TVector& Position) const {
+            auto position = ToArray(Position);
+            size_t cell = 0;
+            for (size_t axis = Dim; axis-- > 0;) {
+                auto index = GetAxisCell(axis, position[axis]);
+                if (!index) {
+                    return std::nullopt;
+                }
+                cell = cell * Resolution + *index;
+            }
+            return cell;
+        }
+
+        /**
+         * @param ClosedMin If data can be on the min side of the boundary along each axis.
+         * @return The cell that all data in the boundary is in, if there is one.
+         */
+        [[nodiscard]] std::optional<size_t> GetCell(const TBoundary& Bound, const std::array<bool, Dim>& ClosedMin) const {
+            auto min = ToArray(Bound.Min);
+            auto max = ToArray(Bound.Max);
+            size_t cell = 0;
+            for (size_t axis = Dim; axis-- > 0;) {
+                auto index = GetAxisCell(axis, max[axis]);
+                if (!index) {
+                    return std::nullopt;
+                }
+                float lower = Edges[axis][*index];
+                if (min[axis] < lower || (min[axis] == lower && *index > 0 && ClosedMin[axis])) {
+                    return std::nullopt;
+                }
+                cell = cell * Resolution + *index;
+            }
+            return cell;
+        }
+
+        size_t Resolution;
+        size_t NrCells = 0;
+        std::array<std::vector<float>, Dim> Edges;
+    };
+
+    /**
+     * Data in a node is above the min side of the node along an axis, since data on a split point is put in
+     * the lower section, unless the min side is the min side of the root or the root has been grown.
+     */
+    [[nodiscard]] std::array<bool, TBoundary::Dim> GetClosedMin(const TBoundary& Bound) const {
+        std::array<bool, TBoundary::Dim> result;
+        auto min = ToArray(Bound.Min);
+        auto rootMin = ToArray(BoundaryData.Min);
+        for (size_t axis = 0; axis < TBoundary::Dim; axis++) {
+            result[axis] = Bounds == BoundaryPolicy::Grow || min[axis] == rootMin[axis];
+        }
+        return result;
+    }
+
+    /**
+     * Doubles the root towards the position until it is inside, the current root is moved
+     * down as one of the children of the new root so no existing node is touched.
+     */
+    void GrowTowards(const TVector& Position) {
+        if (BoundaryData.GetVolume() <= 0.0f) {
+            throw std::runtime_error("Boundary needs a size to grow");
+        }
+        while (!IsPointInBoundrary(Position, BoundaryData)) {
+            if (!std::isfinite(BoundaryData.GetVolume()) || Depth >= MaxDepth) {
+                throw std::runtime_error("Vector can't be reached by growing the boundary");
+            }
+            auto split = GetGrowthPoint(BoundaryData, Position);
+            auto grown = GetGrownBoundary(BoundaryData, Position);
+            size_t section = LocateSection(BoundaryData.GetMidpoint(), split);
+            NodeIndex newRoot = CreateNode(grown, 0);
+            Nodes[newRoot].Children[section] = Root;
+            Nodes[newRoot].NrObjects = Nodes[Root].NrObjects;
+            if constexpr (HasKeys) {
+                NodeKeys[newRoot] = NodeKeys[Root];
+            }
+            SplitPoints[newRoot] = split;
+            Root = newRoot;
+            BoundaryData = grown;
+            Depth++;
+        }
+    }
+
+    [[nodiscard]] bool ValidateInvariant(NodeIndex Index, const TBoundary& Bound) const {
+        const auto& data = DataBlocks[Index];
+        if (data.size() >= MaxData) {
             return false;
         }
-        for (const auto& data : Data) {
-            if (!IsPointInBoundrary(data.Vector, BoundaryData)) {
+        for (const auto& wrapper : data) {
+            if (!IsPointInBoundrary(wrapper.Vector, Bound)) {
                 return false;
             }
         }
         return true;
     }
 
-    std::array<std::unique_ptr<OctreeCpp<TVector, TData>>, static_cast<int>(Section::Count)> Children;
-    std::vector<TDataWrapper> Data;
+    std::vector<Node> Nodes;
+    std::vector<std::vector<TDataWrapper>> DataBlocks;
+    std::vector<TVector> SplitPoints;
+    // The key bounds of every node, only used when the octree has keys.
+    std::vector<TKeyBounds> NodeKeys;
+    NodeIndex Root = NoNode;
     TBoundary BoundaryData;
+    SplitPolicy Split;
+    BoundaryPolicy Bounds = BoundaryPolicy::Fixed;
     size_t NrObjects = 0;
+    size_t Depth = 0;
 };
+
+/**
+ * Octree that only stores positions and a 32 bit handle into caller owned storage,
+ * query results are handles that can be resolved against the callers own data.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ */
+template <typename TVector>
+using HandleOctreeCpp = OctreeCpp<TVector, DataHandle>;
+
+#include "FrozenOctreeCpp.h"
@@ -58,6 +58,38 @@ struct CylinderQuery {
     }
 };
 
+template <IsDataWrapper TDataWrapper>
+struct BoxQuery {
+    const Boundary<typename TDataWrapper::VectorType> Bounds = {};
+
+    bool IsInside(const TDataWrapper& Data) const {
+        return IsPointInBoundrary(Data.Vector, Bounds);
+    }
+
+    bool Covers(const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
+        return DistanceSquared(Boundary, Bounds) <= 0.0f;
+    }
+};
+
+/**
+ * Sphere in a periodic boundary, also finds the data that is within the radius through the sides
+ * of the boundary by using the distance to the closest image of the data.
+ */
+template <IsDataWrapper TDataWrapper>
+struct PeriodicSphereQuery {
+    const typename TDataWrapper::VectorType Midpoint = {};
+    const float Radius = 0.0f;
+    const Boundary<typename TDataWrapper::VectorType> Period = {};
+
+    bool IsInside(const TDataWrapper& Data) const {
+        return PeriodicDistanceSquared(Midpoint, Data.Vector, Period) <= Radius * Radius;
+    }
+
+    bool Covers(const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
+        return PeriodicCheckOverlapp(Boundary, Midpoint, Radius, Period);
+    }
+};
+
 template <IsDataWrapper TDataWrapper>
 struct PredQuery {
     std::function<bool(const TDataWrapper&)> Pred;
@@ -71,6 +103,50 @@ struct PredQuery {
     }
 };
 
+/**
+ * Queries can skip nodes on the key bounds of the payload, see KeyBounds, by having a CoversKeys
+ * function. Queries without it covers all key bounds.
+ */
+template <typename TQuery, typename TKeyBounds>
+bool QueryCoversKeys(const TQuery& Query, const TKeyBounds& Bounds) {
+    if constexpr (requires { { Query.CoversKeys(Bounds) } -> std::convertible_to<bool>; }) {
+        return Query.CoversKeys(Bounds);
+    } else {
+        return true;
+    }
+}
+
+/**
+ * Key range query, for finding objects where the key TKey extracts from the payload is within [Min, Max].
+ * Octrees that keeps the bounds of TKey skip the nodes where no key is in the range.
+ */
+template <IsDataWrapper TDataWrapper, typename TKey>
+struct KeyRangeQuery {
+    using KeyType = std::invoke_result_t<const TKey&, const typename TDataWrapper::DataT&>;
+
+    const KeyType Min = {};
+    const KeyType Max = {};
+
+    bool IsInside(const TDataWrapper& Data) const {
+        auto key = TKey()(Data.Data);
+        return key >= Min && key <= Max;
+    }
+
+    bool Covers([[maybe_unused]] const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
+        return true;
+    }
+
+    template <typename TKeyBounds>
+    bool CoversKeys(const TKeyBounds& Bounds) const {
+        if constexpr (TKeyBounds::template Has<TKey>) {
+            const auto& [min, max] = Bounds.template Get<TKey>();
+            return min <= Max && max >= Min;
+        } else {
+            return true;
+        }
+    }
+};
+
 template <IsDataWrapper TDataWrapper, IsQuery<TDataWrapper> QueryLHS, IsQuery<TDataWrapper> QueryRHS>
 struct AndQuery {
     QueryLHS Query1;
@@ -83,6 +159,11 @@ struct AndQuery {
     bool Covers(const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
         return Query1.Covers(Boundary) && Query2.Covers(Boundary);
     }
+
+    template <typename TKeyBounds>
+    bool CoversKeys(const TKeyBounds& Bounds) const {
+        return QueryCoversKeys(Query1, Bounds) && QueryCoversKeys(Query2, Bounds);
+    }
 };
 
 template <IsDataWrapper TDataWrapper, IsQuery<TDataWrapper> QueryLHS, IsQuery<TDataWrapper> QueryRHS>
@@ -97,6 +178,11 @@ struct OrQuery {
     bool Covers(const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
         return Query1.Covers(Boundary) || Query2.Covers(Boundary);
     }
+
+    template <typename TKeyBounds>
+    bool CoversKeys(const TKeyBounds& Bounds) const {
+        return QueryCoversKeys(Query1, Bounds) || QueryCoversKeys(Query2, Bounds);
+    }
 };
 
 template <IsDataWrapper TDataWrapper, IsQuery<TDataWrapper> TQuery>
@@ -112,3 +198,66 @@ struct NotQuery {
     }
 };
 
+/**
+ * The axis aligned bounds of the built in queries, everything the query can hit is inside of it.
+ */
+template <typename TDataWrapper>
+Boundary<typename TDataWrapper::VectorType> GetQueryBounds(const SphereQuery<TDataWrapper>& Query) {
+    using TVector = typename TDataWrapper::VectorType;
+    return {
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(Query.Midpoint) - Query.Radius; }),
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(Query.Midpoint) + Query.Radius; })
+    };
+}
+
+template <typename TDataWrapper>
+Boundary<typename TDataWrapper::VectorType> GetQueryBounds(const CircleQuery<TDataWrapper>& Query) {
+    using TVector = typename TDataWrapper::VectorType;
+    return {
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(Query.Midpoint) - Query.Radius; }),
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(Query.Midpoint) + Query.Radius; })
+    };
+}
+
+template <typename TDataWrapper>
+Boundary<typename TDataWrapper::VectorType> GetQueryBounds(const BoxQuery<TDataWrapper>& Query) {
+    return Query.Bounds;
+}
+
+/**
+ * Queries that only read the position of the data, IsInside gives the same result for any payload.
+ */
+template <typename TQuery>
+inline constexpr bool IsPositionQuery = false;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<AllQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<SphereQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<CircleQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<CylinderQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<BoxQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper>
+inline constexpr bool IsPositionQuery<PeriodicSphereQuery<TDataWrapper>> = true;
+
+template <typename TDataWrapper, typename QueryLHS, typename QueryRHS>
+inline constexpr bool IsPositionQuery<AndQuery<TDataWrapper, QueryLHS, QueryRHS>> = IsPositionQuery<QueryLHS> && IsPositionQuery<QueryRHS>;
+
+template <typename TDataWrapper, typename QueryLHS, typename QueryRHS>
+inline constexpr bool IsPositionQuery<OrQuery<TDataWrapper, QueryLHS, QueryRHS>> = IsPositionQuery<QueryLHS> && IsPositionQuery<QueryRHS>;
+
+template <typename TDataWrapper, typename TQuery>
+inline constexpr bool IsPositionQuery<NotQuery<TDataWrapper, TQuery>> = IsPositionQuery<TQuery>;
+
+template <typename TQuery, typename TDataWrapper>
+concept HasQueryBounds = requires(const TQuery& Query) {
+    { GetQueryBounds(Query) } -> std::convertible_to<Boundary<typename TDataWrapper::VectorType>>;
+};
@@ -3,9 +3,22 @@
 //
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <span>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 template <typename TVector>
@@ -24,6 +37,17 @@ concept VectorLike2D = requires(TVector Vector) {
 template <typename TVector>
 concept VectorLike2D_t = (not VectorLike3D<TVector> && VectorLike2D<TVector>);
 
+/**
+ * A 4D vector, the fourth axis is either called t (for spatio-temporal data) or w.
+ */
+template <typename TVector>
+concept VectorLike4D = VectorLike3D<TVector> && (
+        requires(TVector Vector) { { Vector.t } -> std::convertible_to<float>; } ||
+        requires(TVector Vector) { { Vector.w } -> std::convertible_to<float>; });
+
+template <typename TVector>
+concept VectorLike3D_t = (VectorLike3D<TVector> && not VectorLike4D<TVector>);
+
 template <typename T>
 constexpr bool isVectorLike3D() {
     return requires(T Vector) {
@@ -34,169 +58,211 @@ constexpr bool isVectorLike3D() {
 }
 
 template <typename TVector>
-concept VectorLike = requires(TVector Vector) {
-    VectorLike3D<TVector> || VectorLike2D_t<TVector>;
-};
-template <typename TVector>
-requires VectorLike3D<TVector> || VectorLike2D_t<TVector>
-struct Boundary {};
+concept VectorLike = VectorLike3D<TVector> || VectorLike2D_t<TVector>;
 
-template <VectorLike3D TVector>
-struct Boundary<TVector> {
-    const TVector Min = {};
-    const TVector Max = {};
-    static size_t constexpr NrCorners = 8;
-
-    std::array<TVector, NrCorners> Corners() const {
-        std::array<TVector, NrCorners> corners;
-        corners[0] = {Min.x, Min.y, Min.z};
-        corners[1] = {Min.x, Min.y, Max.z};
-        corners[2] = {Min.x, Max.y, Min.z};
-        corners[3] = {Min.x, Max.y, Max.z};
-        corners[4] = {Max.x, Min.y, Min.z};
-        corners[5] = {Max.x, Min.y, Max.z};
-        corners[6] = {Max.x, Max.y, Min.z};
-        corners[7] = {Max.x, Max.y, Max.z};
-        return corners;
+template <typename TVector>
+constexpr size_t Dimensions() {
+    if constexpr (VectorLike4D<TVector>) {
+        return 4;
+    } else if constexpr (VectorLike3D<TVector>) {
+        return 3;
+    } else {
+        return 2;
     }
+}
 
-    TVector GetMidpoint() const {
-        return {
-                (Min.x + Max.x) / 2,
-                (Min.y + Max.y) / 2,
-                (Min.z + Max.z) / 2
-        };
+/**
+ * @return The given axis of the vector, x, y, z and then t or w.
+ */
+template <size_t Axis, typename TVector>
+constexpr decltype(auto) GetAxis(TVector& Vector) {
+    if constexpr (Axis == 0) {
+        return (Vector.x);
+    } else if constexpr (Axis == 1) {
+        return (Vector.y);
+    } else if constexpr (Axis == 2) {
+        return (Vector.z);
+    } else if constexpr (requires { Vector.t; }) {
+        return (Vector.t);
+    } else {
+        return (Vector.w);
     }
+}
 
-    TVector GetSize() const {
-        return {
-                Max.x - Min.x,
-                Max.y - Min.y,
-                Max.z - Min.z
-        };
-    }
-};
+/**
+ * Calls Func with every axis as a std::integral_constant, unrolled at compile time.
+ */
+template <size_t Dim, typename TFunc>
+constexpr void ForEachAxis(TFunc&& Func) {
+    [&]<size_t... Axis>(std::index_sequence<Axis...>) {
+        (Func(std::integral_constant<size_t, Axis>{}), ...);
+    }(std::make_index_sequence<Dim>{});
+}
+
+/**
+ * @return True if Func returns true for every axis, unrolled at compile time.
+ */
+template <size_t Dim, typename TFunc>
+constexpr bool AllAxes(TFunc&& Func) {
+    return [&]<size_t... Axis>(std::index_sequence<Axis...>) {
+        return (Func(std::integral_constant<size_t, Axis>{}) && ...);
+    }(std::make_index_sequence<Dim>{});
+}
 
-template <VectorLike2D_t TVector>
-struct Boundary<TVector> {
-    const TVector Min = {};
-    const TVector Max = {};
-    static size_t constexpr NrCorners = 4;
+/**
+ * @return The sum of Func for every axis, unrolled at compile time.
+ */
+template <size_t Dim, typename TFunc>
+constexpr float SumAxes(TFunc&& Func) {
+    return [&]<size_t... Axis>(std::index_sequence<Axis...>) {
+        return (static_cast<float>(Func(std::integral_constant<size_t, Axis>{})) + ...);
+    }(std::make_index_sequence<Dim>{});
+}
+
+/**
+ * @return A vector with every axis set to the result of Func for that axis.
+ */
+template <typename TVector, typename TFunc>
+constexpr TVector MakeVector(TFunc&& Func) {
+    return [&]<size_t... Axis>(std::index_sequence<Axis...>) {
+        return TVector{static_cast<std::remove_cvref_t<decltype(GetAxis<Axis>(std::declval<TVector&>()))>>(
+                Func(std::integral_constant<size_t, Axis>{}))...};
+    }(std::make_index_sequence<Dimensions<TVector>()>{});
+}
+
+template <VectorLike TVector>
+std::array<float, Dimensions<TVector>()> ToArray(const TVector& Vector) {
+    std::array<float, Dimensions<TVector>()> result;
+    ForEachAxis<Dimensions<TVector>()>([&](auto Axis) {
+        result[Axis] = static_cast<float>(GetAxis<Axis>(Vector));
+    });
+    return result;
+}
+
+template <VectorLike TVector>
+TVector FromArray(const std::array<float, Dimensions<TVector>()>& Values) {
+    return MakeVector<TVector>([&](auto Axis) {
+        return Values[Axis];
+    });
+}
+
+template <VectorLike TVector>
+struct Boundary {
+    using VectorType = TVector;
+    static constexpr size_t Dim = Dimensions<TVector>();
+    static size_t constexpr NrCorners = size_t(1) << Dim;
+
+    TVector Min = {};
+    TVector Max = {};
 
     std::array<TVector, NrCorners> Corners() const {
         std::array<TVector, NrCorners> corners;
-        corners[0] = {Min.x, Min.y};
-        corners[1] = {Min.x, Max.y};
-        corners[2] = {Max.x, Min.y};
-        corners[3] = {Max.x, Max.y};
+        for (size_t i = 0; i < NrCorners; i++) {
+            corners[i] = MakeVector<TVector>([&](auto Axis) {
+                return (i >> (Dim - 1 - Axis)) & 1 ? GetAxis<Axis>(Max) : GetAxis<Axis>(Min);
+            });
+        }
         return corners;
     }
 
     TVector GetMidpoint() const {
-        return {
-                (Min.x + Max.x) / 2,
-                (Min.y + Max.y) / 2
-        };
+        return MakeVector<TVector>([this](auto Axis) {
+            return (GetAxis<Axis>(Min) + GetAxis<Axis>(Max)) / 2;
+        });
     }
 
     TVector GetSize() const {
-        return {
-                Max.x - Min.x,
-                Max.y - Min.y
-        };
+        return MakeVector<TVector>([this](auto Axis) {
+            return GetAxis<Axis>(Max) - GetAxis<Axis>(Min);
+        });
+    }
+
+    float GetVolume() const {
+        float volume = 1.0f;
+        ForEachAxis<Dim>([&](auto Axis) {
+            volume *= GetAxis<Axis>(Max) - GetAxis<Axis>(Min);
+        });
+        return volume;
     }
 };
 
 template <typename TQuery, typename TDataWrapper>
-concept IsQuery = requires(TQuery Query) {
-    { Query.IsInside(TDataWrapper()) } -> std::convertible_to<bool>;
+concept IsQuery = requires(TQuery Query, const TDataWrapper& Data) {
+    { Query.IsInside(Data) } -> std::convertible_to<bool>;
     { Query.Covers(Boundary<typename TDataWrapper::VectorType>()) } -> std::convertible_to<bool>;
 };
 
 template <typename TDataWrapper>
-concept IsDataWrapper = requires(TDataWrapper DataWrapper) {
+concept IsDataWrapper = requires(const TDataWrapper& DataWrapper) {
     { DataWrapper.Vector } -> std::convertible_to<typename TDataWrapper::VectorType>;
-    { DataWrapper.Data } -> std::convertible_to<typename TDataWrapper::DataT>;
+    { DataWrapper.Data } -> std::convertible_to<const typename TDataWrapper::DataT&>;
 };
 
-template<VectorLike3D TVector>
+template<VectorLike TVector>
 bool IsPointInBoundrary(const TVector& Point, const Boundary<TVector>& Bound) {
-    return Point.x >= Bound.Min.x && Point.x <= Bound.Max.x &&
-           Point.y >= Bound.Min.y && Point.y <= Bound.Max.y &&
-           Point.z >= Bound.Min.z && Point.z <= Bound.Max.z;
+    return AllAxes<Dimensions<TVector>()>([&](auto Axis) {
+        return GetAxis<Axis>(Point) >= GetAxis<Axis>(Bound.Min) && GetAxis<Axis>(Point) <= GetAxis<Axis>(Bound.Max);
+    });
 }
 
-template<VectorLike2D_t TVector>
-bool IsPointInBoundrary(const TVector& Point, const Boundary<TVector>& Bound) {
-    return Point.x >= Bound.Min.x && Point.x <= Bound.Max.x &&
-           Point.y >= Bound.Min.y && Point.y <= Bound.Max.y;
+template<VectorLike TVector>
+bool IsBoundaryInBoundary(const Boundary<TVector>& Inner, const Boundary<TVector>& Outer) {
+    return AllAxes<Dimensions<TVector>()>([&](auto Axis) {
+        return GetAxis<Axis>(Inner.Min) >= GetAxis<Axis>(Outer.Min) && GetAxis<Axis>(Inner.Max) <= GetAxis<Axis>(Outer.Max);
+    });
 }
 
-template<VectorLike3D TVector>
-inline float DistanceSquared(const TVector& Point1, const TVector& Point2) {
-    float diffX = Point1.x - Point2.x;
-    float diffY = Point1.y - Point2.y;
-    float diffZ = Point1.z - Point2.z;
-    return diffX * diffX + diffY * diffY + diffZ * diffZ;
+/**
+ * @return The boundary scaled around its midpoint with the given factor.
+ */
+template<VectorLike TVector>
+Boundary<TVector> GetScaledBoundary(const Boundary<TVector>& Bound, float Factor) {
+    auto mid = Bound.GetMidpoint();
+    auto size = Bound.GetSize();
+    return {
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(mid) - GetAxis<Axis>(size) * Factor / 2; }),
+            MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(mid) + GetAxis<Axis>(size) * Factor / 2; })
+    };
 }
 
-template<VectorLike2D_t TVector>
-inline float DistanceSquared(const TVector& Point1, const TVector& Point2) {
-    float diffX = Point1.x - Point2.x;
-    float diffY = Point1.y - Point2.y;
-    return diffX * diffX + diffY * diffY;
+template<VectorLike TVector>
+inline float DistanceSquared(const Boundary<TVector>& Bound1, const Boundary<TVector>& Bound2) {
+    return SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float diff = std::max({0.0f,
+                               static_cast<float>(GetAxis<Axis>(Bound1.Min) - GetAxis<Axis>(Bound2.Max)),
+                               static_cast<float>(GetAxis<Axis>(Bound2.Min) - GetAxis<Axis>(Bound1.Max))});
+        return diff * diff;
+    });
 }
 
-template <VectorLike3D TVector>
-float Dot(const TVector& v1, const TVector& v2) {
-    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+template<VectorLike TVector>
+inline float DistanceSquared(const TVector& Point1, const TVector& Point2) {
+    return SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float diff = GetAxis<Axis>(Point1) - GetAxis<Axis>(Point2);
+        return diff * diff;
+    });
 }
 
-template <VectorLike2D_t TVector>
+template <VectorLike TVector>
 float Dot(const TVector& v1, const TVector& v2) {
-    return v1.x * v2.x + v1.y * v2.y;
-}
-
-template <VectorLike3D TVector>
-float DistancePointToLine(const TVector& Point, const TVector& LinePoint1, const TVector& LinePoint2) {
-    TVector v = LinePoint2;
-    v.x -= LinePoint1.x;
-    v.y -= LinePoint1.y;
-    v.z -= LinePoint1.z;
-    TVector w = Point;
-    w.x -= LinePoint1.x;
-    w.y -= LinePoint1.y;
-    w.z -= LinePoint1.z;
-    float c1 = Dot(w, v);
-    float c2 = Dot(v, v);
-    float b = c1 / c2;
-    TVector Pb = TVector{LinePoint1};
-    Pb.x += v.x * b;
-    Pb.y += v.y * b;
-    Pb.z += v.z * b;
-
-    return DistanceSquared(Point, Pb);
+    return SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        return GetAxis<Axis>(v1) * GetAxis<Axis>(v2);
+    });
 }
 
-template <VectorLike2D_t TVector>
+template <VectorLike TVector>
 float DistancePointToLine(const TVector& Point, const TVector& LinePoint1, const TVector& LinePoint2) {
-    TVector v = LinePoint2;
-    v.x -= LinePoint1.x;
-    v.y -= LinePoint1.y;
-    TVector w = Point;
-    w.x -= LinePoint1.x;
-    w.y -= LinePoint1.y;
+    TVector v = MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(LinePoint2) - GetAxis<Axis>(LinePoint1); });
+    TVector w = MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(Point) - GetAxis<Axis>(LinePoint1); });
     float c1 = Dot(w, v);
     float c2 = Dot(v, v);
     float b = c1 / c2;
-    TVector Pb = TVector{LinePoint1};
-    Pb.x += v.x * b;
-    Pb.y += v.y * b;
+    TVector Pb = MakeVector<TVector>([&](auto Axis) { return GetAxis<Axis>(LinePoint1) + GetAxis<Axis>(v) * b; });
 
     return DistanceSquared(Point, Pb);
 }
 
-template <VectorLike3D TVector>
+template <VectorLike TVector>
 bool IsBoxInsideCylinder(const Boundary<TVector>& Boundary, const TVector& CylinderPoint1, const TVector& CylinderPoint2, float CylinderRadius) {
     for (const auto& corner : Boundary.Corners()) {
         if (DistancePointToLine(corner, CylinderPoint1, CylinderPoint2) <= CylinderRadius * CylinderRadius) {
@@ -212,142 +278,340 @@ bool IsBoxInsideCylinder(const Boundary<TVector>& Boundary, const TVector& Cylin
 }
 
 template<VectorLike TVector>
-inline TVector Clamp(const TVector& Value, const TVector& Min, const TVector& Max) {
-    return std::min(std::max(Value, Min), Max);
+inline bool CheckOverlapp(const Boundary<TVector>& Boundary, const TVector& Point1, float Radius) {
+    float distance = SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float closest = std::max(static_cast<float>(GetAxis<Axis>(Boundary.Min)),
+                                 std::min(static_cast<float>(GetAxis<Axis>(Point1)), static_cast<float>(GetAxis<Axis>(Boundary.Max))));
+        float diff = closest - GetAxis<Axis>(Point1);
+        return diff * diff;
+    });
+    return distance <= Radius * Radius;
+}
+
+template <VectorLike TVector, typename TData>
+struct DataWrapper {
+    using VectorType = TVector;
+    using DataT = TData;
+
+    VectorType Vector;
+    DataT Data;
+};
+
+/**
+ * Defers construction of a value until it is converted to its type, lets emplace
+ * construct aggregate members in place without an intermediate move.
+ */
+template <typename TConstruct>
+struct DeferredConstruct {
+    TConstruct Construct;
+
+    operator std::invoke_result_t<TConstruct>() const {
+        return Construct();
+    }
+};
+
+/**
+ * Compact payload that refers to data stored outside of the octree, for example
+ * an index into a caller owned vector. Used when the payload is large or can't be
+ * copied and only the position should live in the tree.
+ */
+struct DataHandle {
+    uint32_t Index = 0;
+    auto operator<=>(const DataHandle&) const = default;
+};
+
+template <VectorLike TVector>
+constexpr size_t NrSections() {
+    return size_t(1) << Dimensions<TVector>();
 }
 
-inline bool checkOverlap(float R, float Xc, float Yc, float Zc,
-                         float X1, float Y1, float Z1,
-                         float X2, float Y2, float Z2)
-{
-    int Xn = std::max(X1, std::min(Xc, X2));
-    int Yn = std::max(Y1, std::min(Yc, Y2));
-    int Zn = std::max(Z1, std::min(Zc, Z2));
+/**
+ * @return Index of the section of the split that the vector is in, bit N is set
+ * when the vector is above the split point along axis N.
+ */
+template <VectorLike TVector>
+size_t LocateSection(const TVector& Vector, const TVector& Split) {
+    size_t section = 0;
+    ForEachAxis<Dimensions<TVector>()>([&](auto Axis) {
+        section |= static_cast<size_t>(GetAxis<Axis>(Vector) > GetAxis<Axis>(Split)) << Axis;
+    });
+    return section;
+}
 
-    int Dx = Xn - Xc;
-    int Dy = Yn - Yc;
-    int Zy = Zn - Zc;
-    return (Dx * Dx + Dy * Dy + Zy * Zy) <= R * R;
+/**
+ * @return Boundary of the section with the given index when the boundary is split at Split.
+ */
+template <typename TBoundary>
+TBoundary GetBoundaryFromSection(size_t Section, const TBoundary& Bound, const typename TBoundary::VectorType& Split) {
+    using TVector = typename TBoundary::VectorType;
+    return {
+            MakeVector<TVector>([&](auto Axis) { return (Section >> Axis) & 1 ? GetAxis<Axis>(Split) : GetAxis<Axis>(Bound.Min); }),
+            MakeVector<TVector>([&](auto Axis) { return (Section >> Axis) & 1 ? GetAxis<Axis>(Bound.Max) : GetAxis<Axis>(Split); })
+    };
 }
 
-inline bool checkOverlap2d(float R, float Xc, float Yc,
-                         float X1, float Y1,
-                         float X2, float Y2)
-{
-    int Xn = std::max(X1, std::min(Xc, X2));
-    int Yn = std::max(Y1, std::min(Yc, Y2));
+/**
+ * How a node chooses the point it is split at when it overflows.
+ * Midpoint splits at the geometric center of the node, Median splits at the per axis
+ * median of the data in the node which keeps the tree balanced for clustered data.
+ */
+enum class SplitPolicy {
+    Midpoint = 0,
+    Median
+};
 
-    int Dx = Xn - Xc;
-    int Dy = Yn - Yc;
-    return (Dx * Dx + Dy * Dy) <= R * R;
+inline float Median(std::span<float> Values) {
+    auto mid = Values.begin() + Values.size() / 2;
+    std::nth_element(Values.begin(), mid, Values.end());
+    return *mid;
 }
 
-template<VectorLike3D TVector>
-inline bool CheckOverlapp(const Boundary<TVector>& Boundary, const TVector& Point1, float Radius) {
-    return checkOverlap(Radius, Point1.x, Point1.y, Point1.z, Boundary.Min.x, Boundary.Min.y, Boundary.Min.z, Boundary.Max.x, Boundary.Max.y, Boundary.Max.z);
+/**
+ * @return The smallest boundary that contains all the data, Data can't be empty.
+ */
+template <typename TDataWrapper>
+Boundary<typename TDataWrapper::VectorType> GetBoundaryOf(const std::vector<TDataWrapper>& Data) {
+    using TVector = typename TDataWrapper::VectorType;
+    auto min = Data.front().Vector;
+    auto max = Data.front().Vector;
+    for (const auto& data : Data) {
+        min = MakeVector<TVector>([&](auto Axis) { return std::min(GetAxis<Axis>(min), GetAxis<Axis>(data.Vector)); });
+        max = MakeVector<TVector>([&](auto Axis) { return std::max(GetAxis<Axis>(max), GetAxis<Axis>(data.Vector)); });
+    }
+    return {min, max};
 }
 
-template<VectorLike2D_t TVector>
-inline bool CheckOverlapp(const Boundary<TVector>& Boundary, const TVector& Point1, float Radius) {
-    return checkOverlap2d(Radius, Point1.x, Point1.y, Boundary.Min.x, Boundary.Min.y, Boundary.Max.x, Boundary.Max.y);
+/**
+ * @return The per axis median of the points, Points can't be empty.
+ */
+template <VectorLike TVector>
+TVector GetMedianpoint(const std::vector<TVector>& Points) {
+    std::vector<float> values(Points.size());
+    return MakeVector<TVector>([&](auto Axis) {
+        for (size_t i = 0; i < Points.size(); i++) {
+            values[i] = GetAxis<Axis>(Points[i]);
+        }
+        return Median(values);
+    });
 }
 
-template <VectorLike TVector, std::default_initializable TData>
-struct DataWrapper {
-    using VectorType = TVector;
-    using DataT = TData;
+template <VectorLike TVector, typename TDataWrapper>
+TVector GetMedianpoint(const std::vector<TDataWrapper>& Data, const TVector& Point) {
+    std::vector<float> values;
+    values.reserve(Data.size() + 1);
+    return MakeVector<TVector>([&](auto Axis) {
+        values.clear();
+        values.push_back(GetAxis<Axis>(Point));
+        for (const auto& data : Data) {
+            values.push_back(GetAxis<Axis>(data.Vector));
+        }
+        return Median(values);
+    });
+}
 
-    VectorType Vector;
-    DataT Data;
-};
+/**
+ * The min and max of payload keys over all data in a node and the nodes below it. Every key is
+ * extracted from the payload by a TKey functor, the same way as TTimeOf in TimeBucketedOctreeCpp.
+ * A node without data has an empty range where min is larger than max.
+ */
+template <typename TData, typename... TKeys>
+struct KeyBounds {
+    template <typename TKey>
+    using KeyType = std::invoke_result_t<const TKey&, const TData&>;
+
+    template <typename TKey>
+    static constexpr bool Has = (std::is_same_v<TKey, TKeys> || ...);
+
+    std::tuple<std::pair<KeyType<TKeys>, KeyType<TKeys>>...> Ranges{
+            std::pair{std::numeric_limits<KeyType<TKeys>>::max(), std::numeric_limits<KeyType<TKeys>>::lowest()}...};
+
+    void Extend(const TData& Data) {
+        Extend(Data, std::index_sequence_for<TKeys...>());
+    }
+
+    /**
+     * @return The min and max of the first key of type TKey.
+     */
+    template <typename TKey>
+    requires Has<TKey>
+    const auto& Get() const {
+        return std::get<IndexOf<TKey>()>(Ranges);
+    }
 
-enum class Octant {
-    TopLeftFront = 0,
-    TopRightFront,
-    BottomLeftFront,
-    BottomRightFront,
-    TopLeftBack,
-    TopRightBack,
-    BottomLeftBack,
-    BottomRightBack,
-    Count
+private:
+    template <size_t... Indices>
+    void Extend(const TData& Data, std::index_sequence<Indices...>) {
+        (ExtendRange(std::get<Indices>(Ranges), TKeys()(Data)), ...);
+    }
+
+    template <typename TRange, typename TValue>
+    static void ExtendRange(TRange& Range, const TValue& Value) {
+        Range.first = std::min<typename TRange::first_type>(Range.first, Value);
+        Range.second = std::max<typename TRange::second_type>(Range.second, Value);
+    }
+
+    template <typename TKey>
+    static constexpr size_t IndexOf() {
+        constexpr std::array<bool, sizeof...(TKeys)> matches{std::is_same_v<TKey, TKeys>...};
+        for (size_t i = 0; i < matches.size(); i++) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return matches.size();
+    }
 };
 
-enum class Quadrant {
-    TopLeft = 0,
-    TopRight,
-    BottomLeft,
-    BottomRight,
-    Count
+/**
+ * What happens when data is added outside of the boundary of the octree.
+ * Fixed throws, Grow doubles the root towards the data until it fits, Periodic wraps the data
+ * into the boundary as in a simulation box where every side continues on the opposite side.
+ */
+enum class BoundaryPolicy {
+    Fixed = 0,
+    Grow,
+    Periodic
 };
 
-template <VectorLike3D TVector>
-Octant LocateOctant(const TVector& Vector, const TVector& Midpoint) {
-    if (Vector.x <= Midpoint.x) {
-        if (Vector.y <= Midpoint.y) {
-            return Vector.z <= Midpoint.z ? Octant::BottomLeftBack : Octant::TopLeftBack;
+/**
+ * @return The point moved by whole periods along every axis so it is inside of the boundary.
+ */
+template <VectorLike TVector>
+TVector WrapPoint(const TVector& Point, const Boundary<TVector>& Period) {
+    return MakeVector<TVector>([&](auto Axis) {
+        float min = GetAxis<Axis>(Period.Min);
+        float max = GetAxis<Axis>(Period.Max);
+        float value = GetAxis<Axis>(Point);
+        if (value >= min && value <= max) {
+            return value;
         }
-        return Vector.z <= Midpoint.z ? Octant::BottomLeftFront : Octant::TopLeftFront;
-    }
-    if (Vector.y <= Midpoint.y) {
-        return Vector.z <= Midpoint.z ? Octant::BottomRightBack : Octant::TopRightBack;
-    }
-    return Vector.z <= Midpoint.z ? Octant::BottomRightFront : Octant::TopRightFront;
+        float wrapped = min + std::fmod(value - min, max - min);
+        if (wrapped < min) {
+            wrapped += max - min;
+        }
+        return std::clamp(wrapped, min, max);
+    });
 }
 
-template <VectorLike2D_t TVector>
-Quadrant LocateOctant(const TVector& Vector, const TVector& Midpoint) {
-    if (Vector.x <= Midpoint.x) {
-        return Vector.y <= Midpoint.y ? Quadrant::BottomLeft : Quadrant::TopLeft;
-    }
-    return Vector.y <= Midpoint.y ? Quadrant::BottomRight : Quadrant::TopRight;
+/**
+ * @return The squared distance between the closest images of the points in the periodic boundary.
+ */
+template <VectorLike TVector>
+float PeriodicDistanceSquared(const TVector& Point1, const TVector& Point2, const Boundary<TVector>& Period) {
+    return SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float size = GetAxis<Axis>(Period.Max) - GetAxis<Axis>(Period.Min);
+        float diff = std::fmod(std::abs(static_cast<float>(GetAxis<Axis>(Point1) - GetAxis<Axis>(Point2))), size);
+        diff = std::min(diff, size - diff);
+        return diff * diff;
+    });
 }
 
-template <typename TBoundary>
-TBoundary GetBoundraryFromSection(Octant octant, const TBoundary& Boundary) {
-    auto Midpoint = Boundary.GetMidpoint();
-    auto min = Boundary.Min;
-    auto max = Boundary.Max;
-    switch (octant) {
-        case Octant::BottomLeftBack:
-            return {min, Midpoint};
-        case Octant::BottomLeftFront:
-            return {{min.x, Midpoint.y, min.z}, {Midpoint.x, max.y, Midpoint.z}};
-        case Octant::BottomRightBack:
-            return {{Midpoint.x, min.y, min.z}, {max.x, Midpoint.y, Midpoint.z}};
-        case Octant::BottomRightFront:
-            return {{Midpoint.x, Midpoint.y, min.z}, {max.x, max.y, Midpoint.z}};
-        case Octant::TopLeftBack:
-            return {{min.x, min.y, Midpoint.z}, {Midpoint.x, Midpoint.y, max.z}};
-        case Octant::TopLeftFront:
-            return {{min.x, Midpoint.y, Midpoint.z}, {Midpoint.x, max.y, max.z}};
-        case Octant::TopRightBack:
-            return {{Midpoint.x, min.y, Midpoint.z}, {max.x, Midpoint.y, max.z}};
-        case Octant::TopRightFront:
-            return {Midpoint, max};
-        default:
-            throw std::runtime_error("Invalid octant");
-    }
-    return {};
+/**
+ * @return The squared distance between the closest images of the boundaries in the periodic boundary.
+ * The boundaries must be inside of the periodic boundary.
+ */
+template <VectorLike TVector>
+float PeriodicDistanceSquared(const Boundary<TVector>& Bound1, const Boundary<TVector>& Bound2, const Boundary<TVector>& Period) {
+    return SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float size = GetAxis<Axis>(Period.Max) - GetAxis<Axis>(Period.Min);
+        float diff = std::numeric_limits<float>::max();
+        for (float shift : {-size, 0.0f, size}) {
+            diff = std::min(diff, std::max({0.0f,
+                                            GetAxis<Axis>(Bound1.Min) + shift - GetAxis<Axis>(Bound2.Max),
+                                            GetAxis<Axis>(Bound2.Min) - GetAxis<Axis>(Bound1.Max) - shift}));
+        }
+        return diff * diff;
+    });
 }
 
-template <typename TBoundary>
-TBoundary GetBoundraryFromSection(Quadrant quadrant, const TBoundary& Boundary) {
-    auto Midpoint = Boundary.GetMidpoint();
-    auto min = Boundary.Min;
-    auto max = Boundary.Max;
-    switch (quadrant) {
-        case Quadrant::BottomLeft:
-            return {min, Midpoint};
-        case Quadrant::BottomRight:
-            return {{Midpoint.x, min.y}, {max.x, Midpoint.y}};
-        case Quadrant::TopLeft:
-            return {{min.x, Midpoint.y}, {Midpoint.x, max.y}};
-        case Quadrant::TopRight:
-            return {Midpoint, max};
-        default:
-            throw std::runtime_error("Invalid quadrant");
-    }
-    return {};
+/**
+ * Same as CheckOverlapp but the sphere also overlaps the boundary through the sides of the periodic boundary.
+ * The boundary must be inside of the periodic boundary.
+ */
+template <VectorLike TVector>
+bool PeriodicCheckOverlapp(const Boundary<TVector>& Bound, const TVector& Point, float Radius, const Boundary<TVector>& Period) {
+    auto point = WrapPoint(Point, Period);
+    float distance = SumAxes<Dimensions<TVector>()>([&](auto Axis) {
+        float size = GetAxis<Axis>(Period.Max) - GetAxis<Axis>(Period.Min);
+        float min = GetAxis<Axis>(Bound.Min);
+        float max = GetAxis<Axis>(Bound.Max);
+        float value = GetAxis<Axis>(point);
+        float diff = std::numeric_limits<float>::max();
+        for (float image : {value - size, value, value + size}) {
+            diff = std::min(diff, std::max({0.0f, min - image, image - max}));
+        }
+        return diff * diff;
+    });
+    return distance <= Radius * Radius;
+}
+
+/**
+ * @return The corner of the boundary that becomes the split point of the grown boundary.
+ */
+template <VectorLike TVector>
+TVector GetGrowthPoint(const Boundary<TVector>& Bound, const TVector& Point) {
+    return MakeVector<TVector>([&](auto Axis) {
+        return GetAxis<Axis>(Point) < GetAxis<Axis>(Bound.Min) ? GetAxis<Axis>(Bound.Min) : GetAxis<Axis>(Bound.Max);
+    });
+}
+
+/**
+ * @return The boundary doubled in size towards the point, the old boundary is one section of it.
+ */
+template <VectorLike TVector>
+Boundary<TVector> GetGrownBoundary(const Boundary<TVector>& Bound, const TVector& Point) {
+    auto size = Bound.GetSize();
+    return {
+            MakeVector<TVector>([&](auto Axis) {
+                return GetAxis<Axis>(Point) < GetAxis<Axis>(Bound.Min) ? GetAxis<Axis>(Bound.Min) - GetAxis<Axis>(size) : GetAxis<Axis>(Bound.Min);
+            }),
+            MakeVector<TVector>([&](auto Axis) {
+                return GetAxis<Axis>(Point) < GetAxis<Axis>(Bound.Min) ? GetAxis<Axis>(Bound.Max) : GetAxis<Axis>(Bound.Max) + GetAxis<Axis>(size);
+            })
+    };
+}
+
+/**
+ * Hints the CPU to load the address into cache ahead of use.
+ */
+inline void Prefetch([[maybe_unused]] const void* Address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(Address);
+#endif
 }
 
+/**
+ * Runs Task for every index in [0, Count) spread out over the hardware threads,
+ * the first exception thrown by a task is rethrown when all threads are done.
+ */
+template <typename TTask>
+void ParallelFor(size_t Count, TTask&& Task) {
+    size_t nrThreads = std::min<size_t>(Count, std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]() {
+        for (size_t index = next++; index < Count; index = next++) {
+            try {
+                Task(index);
+            } catch (...) {
+                std::lock_guard lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nrThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "OctreeUtil.h"
+#include "OctreeQuery.h"
+#include <concepts>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * A octree that stores positions as fixed point offsets within the boundary of the node
+ * that owns them instead of as a full vector, which makes every position 2 to 4 times smaller
+ * depending on TCoord.
+ *
+ * Positions are decoded when the node is scanned, a decoded position differs at most
+ * MaxError() from the added position along each axis (half a step of the root node plus float
+ * rounding, deeper nodes are more exact). Queries are tested against the decoded position, to never miss
+ * a hit grow the query with MaxError(), for a sphere the radius by MaxError() * sqrt(dimensions).
+ *
+ * Queries that only read the position, see IsPositionQuery, only copy the payload of the hits. Other
+ * queries, like Pred, are tested with a copy of the payload of every tested position so they work best with
+ * small payloads, for example DataHandle.
+ *
+ * Nodes at MaxDepth are never split, which only happens for many duplicates of the same point, the data
+ * that doesn't fit in such a node is stored in a list of fixed point positions that can grow.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ * @tparam TCoord Unsigned integer type used for each fixed point coordinate.
+ */
+template <typename TVector, typename TData, std::unsigned_integral TCoord = uint16_t>
+requires VectorLike<TVector>
+class QuantizedOctreeCpp {
+private:
+    static constexpr size_t MaxData = 32;
+    // Every level halves the fixed point step, below this the steps are smaller than float precision.
+    static constexpr size_t MaxDepth = 16;
+    static constexpr size_t Dim = Dimensions<TVector>();
+    static constexpr float MaxCoord = static_cast<float>(std::numeric_limits<TCoord>::max());
+
+public:
+    using TDataWrapper = DataWrapper<TVector, TData>;
+    using TBoundary = Boundary<TVector>;
+
+    using Sphere = SphereQuery<TDataWrapper>;
+    using Circle = CircleQuery<TDataWrapper>;
+    using Cylinder = CylinderQuery<TDataWrapper>;
+    using Pred = PredQuery<TDataWrapper>;
+    using All = AllQuery<TDataWrapper>;
+    template <IsQuery<TDataWrapper> Query>
+    using Not = NotQuery<TDataWrapper, Query>;
+    template <IsQuery<TDataWrapper> QueryLHS, IsQuery<TDataWrapper> QueryRHS>
+    using And = AndQuery<TDataWrapper, QueryLHS, QueryRHS>;
+    template <IsQuery<TDataWrapper> QueryLHS, IsQuery<TDataWrapper> QueryRHS>
+    using Or = OrQuery<TDataWrapper, QueryLHS, QueryRHS>;
+
+    /**
+     * Constructor to setup the Octree.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     */
+    explicit QuantizedOctreeCpp(TBoundary Boundary) : BoundaryData(Boundary) {
+    }
+
+    /**
+     * Stores the given data in the octree container, the position is rounded to the closest fixed point step.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) requires std::copy_constructible<TData> {
+        Add(TDataWrapper(DataWrapper));
+    }
+
+    /**
+     * Stores the given data in the octree container, moves the payload instead of copying it.
+     * @param DataWrapper
+     */
+    void Add(TDataWrapper&& DataWrapper) {
+        if (!IsPointInBoundrary(DataWrapper.Vector, BoundaryData)) {
+            throw std::runtime_error("Vector is outside of boundary");
+        }
+
+        auto position = ToArray(DataWrapper.Vector);
+        QuantizedOctreeCpp* node = this;
+        while (node->NrData >= MaxData && node->Depth < MaxDepth) {
+            node->NrObjects++;
+            size_t section = LocateSection(DataWrapper.Vector, node->BoundaryData.GetMidpoint());
+            auto& child = node->Children[section];
+            if (!child) {
+                child.reset(new QuantizedOctreeCpp(GetBoundaryFromSection(section, node->BoundaryData, node->BoundaryData.GetMidpoint()), node->Depth + 1));
+            }
+            node = child.get();
+        }
+        node->NrObjects++;
+        auto min = ToArray(node->BoundaryData.Min);
+        auto size = ToArray(node->BoundaryData.GetSize());
+        node->Payload.push_back(std::move(DataWrapper.Data));
+        if (node->NrData < MaxData) {
+            for (size_t axis = 0; axis < Dim; axis++) {
+                node->Coords[axis][node->NrData] = Encode(position[axis], min[axis], size[axis]);
+            }
+            node->NrData++;
+        } else {
+            auto& coords = node->Overflow.emplace_back();
+            for (size_t axis = 0; axis < Dim; axis++) {
+                coords[axis] = Encode(position[axis], min[axis], size[axis]);
+            }
+        }
+    }
+
+    /**
+     * Queries the octree and returns all results that returns a hit, with decoded positions.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) const {
+        std::vector<TDataWrapper> result;
+        std::optional<TDataWrapper> probe;
+        QueryInternal(QueryObject, probe, result);
+        return result;
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return NrObjects;
+    }
+
+    /**
+     * @return The max difference along any axis between an added position and its decoded position,
+     * half a fixed point step of the root plus the float rounding of decoding.
+     */
+    [[nodiscard]] float MaxError() const {
+        auto size = ToArray(BoundaryData.GetSize());
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        float step = 0.0f;
+        float magnitude = 0.0f;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            step = std::max(step, size[axis] / MaxCoord);
+            magnitude = std::max({magnitude, std::abs(min[axis]), std::abs(max[axis])});
+        }
+        return step / 2 + magnitude * 4 * std::numeric_limits<float>::epsilon();
+    }
+
+    /**
+     * @return The boundraries of the octree.
+     */
+    [[nodiscard]] std::vector<TBoundary> GetBoundaries() const {
+        std::vector<TBoundary> result;
+        result.push_back(BoundaryData);
+        for (const auto& child : Children) {
+            if (child) {
+                auto childBoundaries = child->GetBoundaries();
+                result.insert(result.end(), childBoundaries.begin(), childBoundaries.end());
+            }
+        }
+        return result;
+    }
+
+private:
+    QuantizedOctreeCpp(TBoundary Boundary, size_t Depth)
+        : BoundaryData(Boundary)
+        , Depth(static_cast<uint8_t>(Depth)) {
+    }
+
+    static TCoord Encode(float Value, float Min, float Size) {
+        if (Size <= 0.0f) {
+            return 0;
+        }
+        float normalized = std::clamp((Value - Min) / Size, 0.0f, 1.0f);
+        return static_cast<TCoord>(std::lround(normalized * MaxCoord));
+    }
+
+    /**
+     * Decodes all positions of the node one axis at a time, kept free of branches
+     * so the compiler can vectorize it. The decoded positions are clamped to the boundary
+     * of the node, the rounding of decoding can otherwise put them just outside of it and
+     * pruning on the boundary would drop them.
+     */
+    void Decode(std::array<std::array<float, MaxData>, Dim>& Positions) const {
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        auto size = ToArray(BoundaryData.GetSize());
+        for (size_t axis = 0; axis < Dim; axis++) {
+            const float scale = size[axis] / MaxCoord;
+            const float offset = min[axis];
+            const float upper = max[axis];
+            for (size_t i = 0; i < MaxData; i++) {
+                Positions[axis][i] = std::min(std::max(offset + static_cast<float>(Coords[axis][i]) * scale, offset), upper);
+            }
+        }
+    }
+
+    /**
+     * Tests the decoded position against the query. Queries that only read the position are tested with
+     * Probe, a wrapper that only has its position changed, so the payload is only copied for hits.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    static void TestPosition(const TQueryObject& QueryObject, const std::array<float, Dim>& Position, const TData& Data,
+                             std::optional<TDataWrapper>& Probe, std::vector<TDataWrapper>& Result) {
+        if constexpr (IsPositionQuery<TQueryObject>) {
+            if (!Probe) {
+                Probe.emplace(TDataWrapper{FromArray<TVector>(Position), Data});
+            }
+            Probe->Vector = FromArray<TVector>(Position);
+            if (QueryObject.IsInside(*Probe)) {
+                Result.push_back({Probe->Vector, Data});
+            }
+        } else {
+            TDataWrapper data{FromArray<TVector>(Position), Data};
+            if (QueryObject.IsInside(data)) {
+                Result.push_back(std::move(data));
+            }
+        }
+    }
+
+    template <IsQuery<TDataWrapper> TQueryObject>
+    void QueryInternal(const TQueryObject& QueryObject, std::optional<TDataWrapper>& Probe, std::vector<TDataWrapper>& Result) const {
+        std::array<std::array<float, MaxData>, Dim> positions;
+        Decode(positions);
+        std::array<float, Dim> position;
+        for (size_t i = 0; i < NrData; i++) {
+            for (size_t axis = 0; axis < Dim; axis++) {
+                position[axis] = positions[axis][i];
+            }
+            TestPosition(QueryObject, position, Payload[i], Probe, Result);
+        }
+        if (!Overflow.empty()) {
+            auto min = ToArray(BoundaryData.Min);
+            auto max = ToArray(BoundaryData.Max);
+            auto size = ToArray(BoundaryData.GetSize());
+            for (size_t i = 0; i < Overflow.size(); i++) {
+                for (size_t axis = 0; axis < Dim; axis++) {
+                    position[axis] = std::min(std::max(min[axis] + static_cast<float>(Overflow[i][axis]) * (size[axis] / MaxCoord), min[axis]), max[axis]);
+                }
+                TestPosition(QueryObject, position, Payload[MaxData + i], Probe, Result);
+            }
+        }
+        for (const auto& child : Children) {
+            if (child && QueryObject.Covers(child->BoundaryData)) {
+                child->QueryInternal(QueryObject, Probe, Result);
+            }
+        }
+    }
+
+    std::array<std::unique_ptr<QuantizedOctreeCpp>, NrSections<TVector>()> Children;
+    std::array<std::array<TCoord, MaxData>, Dim> Coords = {};
+    std::vector<TData> Payload;
+    // The positions of the data after the first MaxData, only used at MaxDepth.
+    std::vector<std::array<TCoord, Dim>> Overflow;
+    TBoundary BoundaryData;
+    size_t NrObjects = 0;
+    uint8_t NrData = 0;
+    uint8_t Depth = 0;
+};
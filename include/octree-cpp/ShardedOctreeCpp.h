@@ -0,0 +1,477 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * An octree that is split over several worker processes, POSIX only. The top levels of the
+ * octree are split into regions by the midpoints of the boundary and every region is owned by one
+ * shard, region i by shard i % NrShards. Every shard is a worker process with one octree per region,
+ * and talks to the router over a Unix socket pair.
+ *
+ * Add is buffered and sent to the shard in batches. Query only goes to the shards that owns a region
+ * that the query covers, the shards run the query at the same time and the results are merged in shard order.
+ * If sending to or receiving from a shard fails, all shards are stopped and every later call throws,
+ * a shard that has only read part of a message can't be used again.
+ * The data and the queries are sent as bytes so they have to be trivially copyable. A query is sent with the
+ * index of its type in QueryTypes, the built in All, Sphere, Circle, Cylinder, Box and PeriodicSphere followed
+ * by TQueries, so other queries like And have to be listed in TQueries. The messages never carry addresses,
+ * a worker sets up its regions from the first message it gets.
+ *
+ * The shards are started with fork() in the constructor, and the forked process allocates and can throw
+ * before it exits. Only the thread that called fork() exists in the child, so the octree has to be constructed
+ * while the process has no other threads running, for example from ParallelFor or the Parallel options of the
+ * other octrees, or the worker can deadlock on a lock that one of those threads held.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ * @tparam TQueries Query types that can be used besides the built in ones, need to be trivially copyable.
+ */
+template <typename TVector, typename TData, typename... TQueries>
+requires VectorLike<TVector> && std::is_trivially_copyable_v<TVector> && std::is_trivially_copyable_v<TData> &&
+         (IsQuery<TQueries, DataWrapper<TVector, TData>> && ...) && (std::is_trivially_copyable_v<TQueries> && ...)
+class ShardedOctreeCpp {
+private:
+    static constexpr size_t NrSections = ::NrSections<TVector>();
+    static constexpr size_t MaxPending = 4096;
+    static constexpr uint32_t NoTag = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @return The index of TQueryObject in the types, NoTag if it is not one of them.
+     */
+    template <typename TQueryObject, typename... TTypes>
+    static constexpr uint32_t GetQueryTag(std::type_identity<std::tuple<TTypes...>>) {
+        uint32_t tag = 0;
+        bool found = ((std::is_same_v<TQueryObject, TTypes> || (tag++, false)) || ...);
+        return found ? tag : NoTag;
+    }
+
+public:
+    using Tree = OctreeCpp<TVector, TData>;
+    using TDataWrapper = typename Tree::TDataWrapper;
+    using TBoundary = typename Tree::TBoundary;
+
+    using Sphere = typename Tree::Sphere;
+    using Circle = typename Tree::Circle;
+    using Cylinder = typename Tree::Cylinder;
+    using Box = typename Tree::Box;
+    using PeriodicSphere = typename Tree::PeriodicSphere;
+    using All = typename Tree::All;
+
+    /**
+     * The query types that Query can send to the shards.
+     */
+    using QueryTypes = std::tuple<All, Sphere, Circle, Cylinder, Box, PeriodicSphere, TQueries...>;
+
+    /**
+     * Constructor that starts the shards, see the class description for when it can be called.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     * @param NrShards Number of worker processes, at least 1.
+     * @param Split How the nodes of the shard octrees choose the point they are split at.
+     */
+    explicit ShardedOctreeCpp(TBoundary Boundary, size_t NrShards = 4, SplitPolicy Split = SplitPolicy::Midpoint)
+        : BoundaryData(Boundary)
+        , Regions(SplitIntoRegions(Boundary, NrShards, Levels)) {
+        Shards.resize(NrShards);
+        Setup setup{Boundary, NrShards, Split};
+        for (size_t i = 0; i < NrShards; i++) {
+            if (!StartShard(i, setup)) {
+                Shutdown();
+                throw std::runtime_error("Failed to start shard");
+            }
+        }
+    }
+
+    ShardedOctreeCpp(const ShardedOctreeCpp&) = delete;
+    ShardedOctreeCpp& operator=(const ShardedOctreeCpp&) = delete;
+
+    ~ShardedOctreeCpp() {
+        Shutdown();
+    }
+
+    /**
+     * Stores the given data in the shard that owns its region. The data is buffered and sent
+     * in batches, it is always sent before the next query.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) {
+        CheckConnected();
+        if (!IsPointInBoundrary(DataWrapper.Vector, BoundaryData)) {
+            throw std::runtime_error("Data is outside of boundary");
+        }
+        auto region = LocateRegion(DataWrapper.Vector);
+        auto& shard = Shards[region % Shards.size()];
+        shard.Pending.push_back({region, DataWrapper});
+        if (shard.Pending.size() >= MaxPending) {
+            Flush(shard);
+        }
+        NrObjects++;
+    }
+
+    /**
+     * Sends all buffered data to the shards.
+     */
+    void Flush() {
+        CheckConnected();
+        for (auto& shard : Shards) {
+            Flush(shard);
+        }
+    }
+
+    /**
+     * Queries the shards that the query covers and returns all results that returns a hit.
+     *
+     * @tparam TQueryObject The query type passed in, one of QueryTypes.
+     * @param QueryObject The object of TQueryObject with the query
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires (GetQueryTag<TQueryObject>(std::type_identity<QueryTypes>()) != NoTag)
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject) {
+        Flush();
+        std::vector<bool> covered(Shards.size(), false);
+        for (size_t region = 0; region < Regions.size(); region++) {
+            if (QueryObject.Covers(Regions[region])) {
+                covered[region % Shards.size()] = true;
+            }
+        }
+        Header header{MessageType::Query, GetQueryTag<TQueryObject>(std::type_identity<QueryTypes>()), sizeof(TQueryObject)};
+        for (size_t i = 0; i < Shards.size(); i++) {
+            if (covered[i]) {
+                Send(Shards[i], &header, sizeof(header));
+                Send(Shards[i], &QueryObject, sizeof(TQueryObject));
+            }
+        }
+        std::vector<TDataWrapper> result;
+        for (size_t i = 0; i < Shards.size(); i++) {
+            if (covered[i]) {
+                uint64_t count = 0;
+                Receive(Shards[i], &count, sizeof(count));
+                size_t offset = result.size();
+                result.resize(offset + count);
+                Receive(Shards[i], result.data() + offset, count * sizeof(TDataWrapper));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return NrObjects;
+    }
+
+    /**
+     * @return Number of worker processes.
+     */
+    [[nodiscard]] size_t NrShards() const {
+        return Shards.size();
+    }
+
+    /**
+     * @return The boundary of the root of the octree.
+     */
+    [[nodiscard]] const TBoundary& GetBoundary() const {
+        return BoundaryData;
+    }
+
+private:
+    enum class MessageType : uint32_t {
+        Setup = 0,
+        Add,
+        Query,
+        Quit
+    };
+
+    struct Header {
+        MessageType Type;
+        // Index of the query type in QueryTypes.
+        uint32_t Tag = NoTag;
+        uint64_t Size = 0;
+    };
+
+    /**
+     * The first message a worker gets, the worker splits the boundary into the same regions as the router.
+     */
+    struct Setup {
+        TBoundary Boundary;
+        uint64_t NrShards;
+        SplitPolicy Split;
+    };
+
+    struct AddItem {
+        uint64_t Region;
+        TDataWrapper Data;
+    };
+
+    /**
+     * The octrees of the regions that a shard owns, only exists in the worker process.
+     */
+    struct Worker {
+        std::vector<TBoundary> Regions;
+        SplitPolicy Split;
+        std::vector<std::unique_ptr<Tree>> Octrees;
+    };
+
+    struct Shard {
+        int Socket = -1;
+        pid_t Pid = -1;
+        std::vector<AddItem> Pending;
+    };
+
+    static std::vector<TBoundary> SplitIntoRegions(const TBoundary& Boundary, size_t NrShards, size_t& Levels) {
+        if (NrShards == 0) {
+            throw std::runtime_error("Invalid number of shards");
+        }
+        std::vector<TBoundary> regions{Boundary};
+        Levels = 0;
+        while (regions.size() < NrShards) {
+            std::vector<TBoundary> next;
+            for (const auto& region : regions) {
+                for (size_t i = 0; i < NrSections; i++) {
+                    next.push_back(GetBoundaryFromSection(i, region, region.GetMidpoint()));
+                }
+            }
+            regions = std::move(next);
+            Levels++;
+        }
+        return regions;
+    }
+
+    size_t LocateRegion(const TVector& Position) const {
+        size_t region = 0;
+        TBoundary bound = BoundaryData;
+        for (size_t level = 0; level < Levels; level++) {
+            auto split = bound.GetMidpoint();
+            size_t section = LocateSection(Position, split);
+            bound = GetBoundaryFromSection(section, bound, split);
+            region = region * NrSections + section;
+        }
+        return region;
+    }
+
+    bool StartShard(size_t Index, const Setup& ShardSetup) {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            return false;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(sockets[0]);
+            close(sockets[1]);
+            return false;
+        }
+        if (pid == 0) {
+            close(sockets[0]);
+            for (size_t i = 0; i < Index; i++) {
+                close(Shards[i].Socket);
+            }
+            int status = 0;
+            try {
+                RunWorker(sockets[1]);
+            } catch (...) {
+                status = 1;
+            }
+            _exit(status);
+        }
+        close(sockets[1]);
+        Shards[Index].Socket = sockets[0];
+        Shards[Index].Pid = pid;
+        Header header{MessageType::Setup, NoTag, sizeof(Setup)};
+        return WriteAll(sockets[0], &header, sizeof(header)) && WriteAll(sockets[0], &ShardSetup, sizeof(Setup));
+    }
+
+    void Shutdown() {
+        for (auto& shard : Shards) {
+            if (shard.Socket < 0) {
+                continue;
+            }
+            Header header{MessageType::Quit};
+            WriteAll(shard.Socket, &header, sizeof(header));
+            close(shard.Socket);
+            waitpid(shard.Pid, nullptr, 0);
+            shard.Socket = -1;
+        }
+    }
+
+    void Flush(Shard& Target) {
+        if (Target.Pending.empty()) {
+            return;
+        }
+        Header header{MessageType::Add, NoTag, Target.Pending.size()};
+        Send(Target, &header, sizeof(header));
+        Send(Target, Target.Pending.data(), Target.Pending.size() * sizeof(AddItem));
+        Target.Pending.clear();
+    }
+
+    /**
+     * The loop of a worker process, it only uses what it reads from the socket.
+     */
+    static void RunWorker(int Socket) {
+        Header header;
+        Setup setup;
+        if (!ReadAll(Socket, &header, sizeof(header)) || header.Type != MessageType::Setup || header.Size != sizeof(Setup) ||
+            !ReadAll(Socket, &setup, sizeof(setup))) {
+            return;
+        }
+        Worker worker;
+        size_t levels = 0;
+        worker.Regions = SplitIntoRegions(setup.Boundary, setup.NrShards, levels);
+        worker.Split = setup.Split;
+        worker.Octrees.resize(worker.Regions.size());
+
+        std::vector<AddItem> items;
+        std::vector<char> query;
+        std::vector<TDataWrapper> result;
+        while (ReadAll(Socket, &header, sizeof(header))) {
+            if (header.Type == MessageType::Add) {
+                items.resize(header.Size);
+                if (!ReadAll(Socket, items.data(), items.size() * sizeof(AddItem))) {
+                    return;
+                }
+                for (const auto& item : items) {
+                    if (item.Region >= worker.Regions.size()) {
+                        return;
+                    }
+                    auto& octree = worker.Octrees[item.Region];
+                    if (!octree) {
+                        octree = std::make_unique<Tree>(worker.Regions[item.Region], worker.Split);
+                    }
+                    octree->Add(item.Data);
+                }
+            } else if (header.Type == MessageType::Query) {
+                query.resize(header.Size);
+                if (!ReadAll(Socket, query.data(), query.size())) {
+                    return;
+                }
+                result.clear();
+                if (!DispatchQuery(header.Tag, worker, query, result, std::type_identity<QueryTypes>())) {
+                    return;
+                }
+                uint64_t count = result.size();
+                if (!WriteAll(Socket, &count, sizeof(count)) || !WriteAll(Socket, result.data(), result.size() * sizeof(TDataWrapper))) {
+                    return;
+                }
+            } else {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Runs the query whose type has the index Tag in the types.
+     * @return False if the tag or the size of the query doesn't match one of the types.
+     */
+    template <typename... TTypes>
+    static bool DispatchQuery(uint32_t Tag, const Worker& Worker, const std::vector<char>& Bytes, std::vector<TDataWrapper>& Result,
+                              std::type_identity<std::tuple<TTypes...>>) {
+        uint32_t index = 0;
+        return ((Tag == index++ && RunQuery<TTypes>(Worker, Bytes, Result)) || ...);
+    }
+
+    template <typename TQueryObject>
+    static bool RunQuery(const Worker& Worker, const std::vector<char>& Bytes, std::vector<TDataWrapper>& Result) {
+        if (Bytes.size() != sizeof(TQueryObject)) {
+            return false;
+        }
+        alignas(TQueryObject) char storage[sizeof(TQueryObject)];
+        std::memcpy(storage, Bytes.data(), sizeof(TQueryObject));
+        const auto& query = *std::launder(reinterpret_cast<const TQueryObject*>(storage));
+        for (size_t region = 0; region < Worker.Regions.size(); region++) {
+            const auto& octree = Worker.Octrees[region];
+            if (octree && query.Covers(Worker.Regions[region])) {
+                for (const auto& data : octree->QueryRefs(query)) {
+                    Result.push_back(data.get());
+                }
+            }
+        }
+        return true;
+    }
+
+    void CheckConnected() const {
+        if (Disconnected) {
+            throw std::runtime_error("Lost connection to shard");
+        }
+    }
+
+    /**
+     * Stops all shards after a failed send or receive, the shards can have unread or partly sent messages.
+     */
+    [[noreturn]] void Disconnect() {
+        Disconnected = true;
+        for (auto& shard : Shards) {
+            if (shard.Socket >= 0) {
+                close(shard.Socket);
+                waitpid(shard.Pid, nullptr, 0);
+                shard.Socket = -1;
+            }
+            shard.Pending.clear();
+        }
+        throw std::runtime_error("Lost connection to shard");
+    }
+
+    void Send(const Shard& Target, const void* Bytes, size_t Size) {
+        if (!WriteAll(Target.Socket, Bytes, Size)) {
+            Disconnect();
+        }
+    }
+
+    void Receive(const Shard& Target, void* Bytes, size_t Size) {
+        if (!ReadAll(Target.Socket, Bytes, Size)) {
+            Disconnect();
+        }
+    }
+
+    static bool WriteAll(int Socket, const void* Bytes, size_t Size) {
+        auto data = static_cast<const char*>(Bytes);
+        while (Size > 0) {
+#ifdef MSG_NOSIGNAL
+            ssize_t written = send(Socket, data, Size, MSG_NOSIGNAL);
+#else
+            ssize_t written = send(Socket, data, Size, 0);
+#endif
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            Size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    static bool ReadAll(int Socket, void* Bytes, size_t Size) {
+        auto data = static_cast<char*>(Bytes);
+        while (Size > 0) {
+            ssize_t read = recv(Socket, data, Size, 0);
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                return false;
+            }
+            data += read;
+            Size -= static_cast<size_t>(read);
+        }
+        return true;
+    }
+
+    TBoundary BoundaryData;
+    size_t Levels = 0;
+    std::vector<TBoundary> Regions;
+    std::vector<Shard> Shards;
+    size_t NrObjects = 0;
+    bool Disconnected = false;
+};
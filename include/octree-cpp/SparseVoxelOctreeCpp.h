@@ -0,0 +1,453 @@
+#pragma once
+
+#include "OctreeUtil.h"
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * An octree that only stores if a voxel is filled, for occupancy and collision maps. The boundary
+ * is split into 2^Depth voxels along every axis. A node only stores a bitmask of which children
+ * exists and the index of them, the last level is a bitmask of the filled voxels, no points are stored.
+ *
+ * Compact merges identical subtrees so the tree becomes a directed acyclic graph, which shrinks maps with
+ * a lot of repeated structure like large filled or empty regions by orders of magnitude. Filling voxels after
+ * Compact copies the nodes on the path to the voxel that can be shared instead of changing them, the copies
+ * are only used by one parent and are changed in place. The old nodes are dropped by the next Compact.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ */
+template <typename TVector>
+requires VectorLike<TVector>
+class SparseVoxelOctreeCpp {
+private:
+    static constexpr size_t Dim = Dimensions<TVector>();
+    static constexpr size_t NrSections = ::NrSections<TVector>();
+    // Voxels smaller than this can't be told apart with float positions.
+    static constexpr size_t MaxDepth = 24;
+    using NodeIndex = uint32_t;
+    static constexpr NodeIndex NoNode = std::numeric_limits<NodeIndex>::max();
+    using Mask = std::conditional_t<(NrSections <= 8), uint8_t, uint16_t>;
+    using Voxel = std::array<uint32_t, Dim>;
+
+public:
+    using TBoundary = Boundary<TVector>;
+
+    /**
+     * Constructor to setup the voxel octree.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     * @param Depth Number of levels, the boundary is split into 2^Depth voxels along every axis. Between 1 and 24.
+     */
+    SparseVoxelOctreeCpp(TBoundary Boundary, size_t Depth)
+        : BoundaryData(Boundary)
+        , Depth(Depth) {
+        if (Depth == 0 || Depth > MaxDepth) {
+            throw std::runtime_error("Invalid depth");
+        }
+    }
+
+    /**
+     * Fills the voxel that the position is in.
+     * @param Position
+     */
+    void Set(const TVector& Position) {
+        if (!IsPointInBoundrary(Position, BoundaryData)) {
+            throw std::runtime_error("Vector is outside of boundary");
+        }
+        if (IsOccupied(Position)) {
+            return;
+        }
+        auto voxel = ToVoxel(Position);
+        NodeIndex parent = NoNode;
+        size_t parentSection = 0;
+        for (size_t level = 0; level < Depth; level++) {
+            bool isLeaf = level + 1 == Depth;
+            NodeIndex index = parent == NoNode ? Root : Nodes[parent].Children[parentSection];
+            if (index == NoNode || index < (isLeaf ? SharedLeaves : SharedNodes)) {
+                index = isLeaf ? CreateLeaf(index) : CreateNode(index);
+                (parent == NoNode ? Root : Nodes[parent].Children[parentSection]) = index;
+            }
+            size_t section = GetSection(voxel, level);
+            if (isLeaf) {
+                LeafMasks[index] |= static_cast<Mask>(1u << section);
+            } else {
+                Nodes[index].ChildMask |= static_cast<Mask>(1u << section);
+            }
+            parent = index;
+            parentSection = section;
+        }
+        NrFilled++;
+    }
+
+    /**
+     * @return If the voxel that the position is in is filled, false outside of the boundary.
+     */
+    [[nodiscard]] bool IsOccupied(const TVector& Position) const {
+        if (Root == NoNode || !IsPointInBoundrary(Position, BoundaryData)) {
+            return false;
+        }
+        auto voxel = ToVoxel(Position);
+        NodeIndex index = Root;
+        for (size_t level = 0; level + 1 < Depth; level++) {
+            size_t section = GetSection(voxel, level);
+            if (!((Nodes[index].ChildMask >> section) & 1u)) {
+                return false;
+            }
+            index = Nodes[index].Children[section];
+        }
+        return (LeafMasks[index] >> GetSection(voxel, Depth - 1)) & 1u;
+    }
+
+    /**
+     * @return If any filled voxel overlaps the region, stops at the first one that is found.
+     */
+    [[nodiscard]] bool IsAnyOccupied(const TBoundary& Region) const {
+        auto range = ToVoxelRange(Region);
+        if (!range) {
+            return false;
+        }
+        return Traverse([&](const Voxel& Origin, uint32_t Size) -> std::optional<float> {
+            if (!IsInVoxelRange(Origin, Size, *range)) {
+                return std::nullopt;
+            }
+            return 0.0f;
+        }, [](const TBoundary&) {
+            return true;
+        });
+    }
+
+    /**
+     * @return The boundaries of all filled voxels that overlaps the region.
+     */
+    [[nodiscard]] std::vector<TBoundary> QueryVoxels(const TBoundary& Region) const {
+        std::vector<TBoundary> result;
+        auto range = ToVoxelRange(Region);
+        if (!range) {
+            return result;
+        }
+        Traverse([&](const Voxel& Origin, uint32_t Size) -> std::optional<float> {
+            if (!IsInVoxelRange(Origin, Size, *range)) {
+                return std::nullopt;
+            }
+            return 0.0f;
+        }, [&result](const TBoundary& Voxel) {
+            result.push_back(Voxel);
+            return false;
+        });
+        return result;
+    }
+
+    /**
+     * Finds the first filled voxel along a ray. The children of a node are visited in the order the ray enters
+     * them, so the search stops at the first hit.
+     *
+     * @param Origin Start of the ray.
+     * @param Direction Direction of the ray, does not need to be normalized.
+     * @param MaxDistance The ray ends at Origin + Direction * MaxDistance.
+     * @return How far along the ray the first filled voxel is in lengths of Direction, nothing if no voxel is hit.
+     */
+    [[nodiscard]] std::optional<float> Raycast(const TVector& Origin, const TVector& Direction, float MaxDistance = std::numeric_limits<float>::max()) const {
+        std::optional<float> result;
+        Traverse([&](const Voxel& Voxel, uint32_t Size) {
+            return IntersectRay(GetBoundary(Voxel, Size), Origin, Direction, MaxDistance);
+        }, [&](const TBoundary& Voxel) {
+            result = IntersectRay(Voxel, Origin, Direction, MaxDistance);
+            return true;
+        });
+        return result;
+    }
+
+    /**
+     * Merges all identical subtrees and drops the nodes that are no longer used. Nodes are read based on
+     * their level, so nodes with the same content are merged even when they are on different levels.
+     */
+    void Compact() {
+        Compacted compacted;
+        Root = CompactNode(Root, 0, compacted);
+        Nodes = std::move(compacted.Nodes);
+        LeafMasks = std::move(compacted.LeafMasks);
+        SharedNodes = static_cast<NodeIndex>(Nodes.size());
+        SharedLeaves = static_cast<NodeIndex>(LeafMasks.size());
+    }
+
+    /**
+     * @return Number of filled voxels.
+     */
+    [[nodiscard]] size_t NrVoxels() const {
+        return NrFilled;
+    }
+
+    /**
+     * @return Number of stored nodes, the last level included.
+     */
+    [[nodiscard]] size_t NrNodes() const {
+        return Nodes.size() + LeafMasks.size();
+    }
+
+    /**
+     * @return Number of bytes used by the nodes.
+     */
+    [[nodiscard]] size_t MemoryUsage() const {
+        return Nodes.size() * sizeof(Node) + LeafMasks.size() * sizeof(Mask);
+    }
+
+    /**
+     * @return The boundary of the root of the octree.
+     */
+    [[nodiscard]] const TBoundary& GetBoundary() const {
+        return BoundaryData;
+    }
+
+private:
+    struct Node {
+        std::array<NodeIndex, NrSections> Children;
+        Mask ChildMask = 0;
+
+        bool operator==(const Node&) const = default;
+    };
+
+    struct NodeHash {
+        size_t operator()(const Node& Node) const {
+            size_t hash = Node.ChildMask;
+            for (auto child : Node.Children) {
+                hash ^= std::hash<NodeIndex>()(child) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+    struct Compacted {
+        std::vector<Node> Nodes;
+        std::vector<Mask> LeafMasks;
+        std::unordered_map<Node, NodeIndex, NodeHash> NodeLookup;
+        std::unordered_map<Mask, NodeIndex> LeafLookup;
+    };
+
+    struct StackEntry {
+        NodeIndex Index;
+        size_t Level;
+        Voxel Origin;
+    };
+
+    /**
+     * The nodes left to visit, every level adds at most NrSections - 1 nodes more than it removes.
+     */
+    struct TraversalStack {
+        std::array<StackEntry, MaxDepth * (NrSections - 1) + 1> Entries;
+        size_t Count = 0;
+
+        [[nodiscard]] bool empty() const { return Count == 0; }
+        void push(const StackEntry& Entry) { Entries[Count++] = Entry; }
+        StackEntry pop() { return Entries[--Count]; }
+    };
+
+    NodeIndex CreateNode(NodeIndex Copy) {
+        Node node;
+        if (Copy == NoNode) {
+            node.Children.fill(NoNode);
+        } else {
+            node = Nodes[Copy];
+        }
+        Nodes.push_back(node);
+        return static_cast<NodeIndex>(Nodes.size() - 1);
+    }
+
+    NodeIndex CreateLeaf(NodeIndex Copy) {
+        LeafMasks.push_back(Copy == NoNode ? 0 : LeafMasks[Copy]);
+        return static_cast<NodeIndex>(LeafMasks.size() - 1);
+    }
+
+    NodeIndex CompactNode(NodeIndex Index, size_t Level, Compacted& Out) const {
+        if (Index == NoNode) {
+            return NoNode;
+        }
+        if (Level + 1 == Depth) {
+            auto [it, inserted] = Out.LeafLookup.try_emplace(LeafMasks[Index], static_cast<NodeIndex>(Out.LeafMasks.size()));
+            if (inserted) {
+                Out.LeafMasks.push_back(LeafMasks[Index]);
+            }
+            return it->second;
+        }
+        Node node = Nodes[Index];
+        for (size_t i = 0; i < NrSections; i++) {
+            node.Children[i] = (node.ChildMask >> i) & 1u ? CompactNode(node.Children[i], Level + 1, Out) : NoNode;
+        }
+        auto [it, inserted] = Out.NodeLookup.try_emplace(node, static_cast<NodeIndex>(Out.Nodes.size()));
+        if (inserted) {
+            Out.Nodes.push_back(node);
+        }
+        return it->second;
+    }
+
+    Voxel ToVoxel(const TVector& Position) const {
+        auto point = ToArray(Position);
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        uint32_t last = (1u << Depth) - 1;
+        Voxel voxel;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            float cell = (point[axis] - min[axis]) / (max[axis] - min[axis]) * static_cast<float>(1u << Depth);
+            voxel[axis] = cell > 0.0f ? std::min(static_cast<uint32_t>(cell), last) : 0;
+        }
+        return voxel;
+    }
+
+    /**
+     * @return The first and last voxel along every axis that the region overlaps, found with ToVoxel so a
+     * region always overlaps the voxel that Set fills for a position inside of it. Nothing if the region
+     * is empty or outside of the boundary.
+     */
+    std::optional<std::pair<Voxel, Voxel>> ToVoxelRange(const TBoundary& Region) const {
+        auto min = ToArray(Region.Min);
+        auto max = ToArray(Region.Max);
+        for (size_t axis = 0; axis < Dim; axis++) {
+            if (!(min[axis] <= max[axis])) {
+                return std::nullopt;
+            }
+        }
+        if (DistanceSquared(BoundaryData, Region) > 0.0f) {
+            return std::nullopt;
+        }
+        return std::make_pair(ToVoxel(Region.Min), ToVoxel(Region.Max));
+    }
+
+    static bool IsInVoxelRange(const Voxel& Origin, uint32_t Size, const std::pair<Voxel, Voxel>& Range) {
+        for (size_t axis = 0; axis < Dim; axis++) {
+            if (Origin[axis] > Range.second[axis] || Origin[axis] + Size <= Range.first[axis]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t GetSection(const Voxel& Voxel, size_t Level) const {
+        size_t section = 0;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            section |= ((Voxel[axis] >> (Depth - 1 - Level)) & 1u) << axis;
+        }
+        return section;
+    }
+
+    /**
+     * @return The boundary of Size voxels along every axis starting at the voxel Origin.
+     */
+    TBoundary GetBoundary(const Voxel& Origin, uint32_t Size) const {
+        auto min = ToArray(BoundaryData.Min);
+        auto max = ToArray(BoundaryData.Max);
+        auto edge = [&](size_t Axis, uint32_t Index) {
+            if (Index == (1u << Depth)) {
+                return max[Axis];
+            }
+            return min[Axis] + (max[Axis] - min[Axis]) * static_cast<float>(Index) / static_cast<float>(1u << Depth);
+        };
+        std::array<float, Dim> lower;
+        std::array<float, Dim> upper;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            lower[axis] = edge(axis, Origin[axis]);
+            upper[axis] = edge(axis, Origin[axis] + Size);
+        }
+        return {FromArray<TVector>(lower), FromArray<TVector>(upper)};
+    }
+
+    /**
+     * @return Where along the ray it enters the boundary, nothing if it misses the boundary.
+     */
+    static std::optional<float> IntersectRay(const TBoundary& Bound, const TVector& Origin, const TVector& Direction, float MaxDistance) {
+        auto min = ToArray(Bound.Min);
+        auto max = ToArray(Bound.Max);
+        auto origin = ToArray(Origin);
+        auto direction = ToArray(Direction);
+        float enter = 0.0f;
+        float exit = MaxDistance;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            if (direction[axis] == 0.0f) {
+                if (origin[axis] < min[axis] || origin[axis] > max[axis]) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+            float t1 = (min[axis] - origin[axis]) / direction[axis];
+            float t2 = (max[axis] - origin[axis]) / direction[axis];
+            enter = std::max(enter, std::min(t1, t2));
+            exit = std::min(exit, std::max(t1, t2));
+        }
+        if (enter > exit) {
+            return std::nullopt;
+        }
+        return enter;
+    }
+
+    /**
+     * Depth first traversal of the filled voxels. Enter is called with the first voxel and the number of voxels
+     * along every axis of every node and voxel and returns nothing to skip it, or a key where the children of a node are visited in the order of the smallest key.
+     * Visit is called for every entered voxel and returns true to stop the traversal.
+     * @return If Visit stopped the traversal.
+     */
+    template <typename TEnter, typename TVisit>
+    bool Traverse(TEnter&& Enter, TVisit&& Visit) const {
+        if (Root == NoNode || !Enter(Voxel{}, 1u << Depth)) {
+            return false;
+        }
+        TraversalStack stack;
+        stack.push({Root, 0, {}});
+        while (!stack.empty()) {
+            auto entry = stack.pop();
+            bool isLeaf = entry.Level + 1 == Depth;
+            Mask mask = isLeaf ? LeafMasks[entry.Index] : Nodes[entry.Index].ChildMask;
+            uint32_t half = 1u << (Depth - 1 - entry.Level);
+            std::array<std::pair<float, size_t>, NrSections> children;
+            size_t count = 0;
+            for (size_t section = 0; section < NrSections; section++) {
+                if (!((mask >> section) & 1u)) {
+                    continue;
+                }
+                auto origin = GetChildOrigin(entry.Origin, section, half);
+                if (auto key = Enter(origin, half)) {
+                    // Insertion sort on the key, there are at most NrSections children.
+                    size_t i = count++;
+                    for (; i > 0 && *key < children[i - 1].first; i--) {
+                        children[i] = children[i - 1];
+                    }
+                    children[i] = {*key, section};
+                }
+            }
+            if (isLeaf) {
+                for (size_t i = 0; i < count; i++) {
+                    if (Visit(GetBoundary(GetChildOrigin(entry.Origin, children[i].second, half), half))) {
+                        return true;
+                    }
+                }
+                continue;
+            }
+            for (size_t i = count; i-- > 0;) {
+                size_t section = children[i].second;
+                stack.push({Nodes[entry.Index].Children[section], entry.Level + 1, GetChildOrigin(entry.Origin, section, half)});
+            }
+        }
+        return false;
+    }
+
+    static Voxel GetChildOrigin(const Voxel& Origin, size_t Section, uint32_t Half) {
+        Voxel result = Origin;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            if ((Section >> axis) & 1u) {
+                result[axis] += Half;
+            }
+        }
+        return result;
+    }
+
+    TBoundary BoundaryData;
+    size_t Depth;
+    std::vector<Node> Nodes;
+    std::vector<Mask> LeafMasks;
+    NodeIndex Root = NoNode;
+    size_t NrFilled = 0;
+    // Nodes and leaves before these indices are made by Compact and can have several parents.
+    NodeIndex SharedNodes = 0;
+    NodeIndex SharedLeaves = 0;
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An octree with standing queries, for triggers and geofences. A query is watched once and its callback
+ * is called every time data that is inside of the query is added, instead of running the query again.
+ *
+ * The watched queries are indexed in a uniform grid over the boundary, every cell lists the queries whose
+ * bounds overlap it. Adding data only tests the queries of the cell it is in, so the cost depends on the
+ * number of added objects and the queries near them and not on the number of watched queries.
+ * Queries without known bounds, see HasQueryBounds, are tested for all added data. Queries with empty bounds,
+ * like a box with its min above its max, are never in a cell.
+ *
+ * The callbacks can call Watch and Unwatch, a query that is watched by a callback is only called
+ * for data that is added after it.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ */
+template <typename TVector, typename TData>
+requires VectorLike<TVector> && std::copy_constructible<TData>
+class StandingQueryOctreeCpp {
+private:
+    static constexpr size_t Dim = Dimensions<TVector>();
+
+public:
+    using Tree = OctreeCpp<TVector, TData>;
+    using TDataWrapper = typename Tree::TDataWrapper;
+    using TBoundary = typename Tree::TBoundary;
+    using QueryId = size_t;
+    using Callback = std::function<void(const TDataWrapper&)>;
+
+    using Sphere = typename Tree::Sphere;
+    using Circle = typename Tree::Circle;
+    using Cylinder = typename Tree::Cylinder;
+    using Box = typename Tree::Box;
+    using Pred = typename Tree::Pred;
+    using All = typename Tree::All;
+
+    /**
+     * Constructor to setup the octree.
+     *
+     * @param Boundary min and max X, Y, Z values of the octree.
+     * @param CellsPerAxis Number of cells along every axis of the query index, at least 1.
+     * @param Split How nodes choose the point they are split at.
+     * @param Bounds What happens when data is added outside of the boundary.
+     */
+    explicit StandingQueryOctreeCpp(TBoundary Boundary, size_t CellsPerAxis = 16, SplitPolicy Split = SplitPolicy::Midpoint, BoundaryPolicy Bounds = BoundaryPolicy::Fixed)
+        : Octree(Boundary, Split, Bounds)
+        , IndexBoundary(Boundary)
+        , CellsPerAxis(CellsPerAxis)
+        , Bounds(Bounds) {
+        if (CellsPerAxis == 0) {
+            throw std::runtime_error("Invalid number of cells");
+        }
+        size_t nrCells = 1;
+        for (size_t i = 0; i < Dim; i++) {
+            nrCells *= CellsPerAxis;
+        }
+        Cells.resize(nrCells);
+    }
+
+    /**
+     * Starts watching a query, OnEnter is called with all data that is already inside of the query
+     * and after that with every added object that is inside of it.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query
+     * @param OnEnter Called with the data that enters the query.
+     * @return Id of the query, used to stop watching it.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TQueryObject>
+    QueryId Watch(const TQueryObject& QueryObject, Callback OnEnter) {
+        for (const auto& data : Octree.QueryRefs(QueryObject)) {
+            OnEnter(data.get());
+        }
+        QueryId id = NextId++;
+        auto standing = std::make_shared<Standing>(Standing{[QueryObject](const TDataWrapper& Data) {
+            return QueryObject.IsInside(Data);
+        }, std::move(OnEnter)});
+        if constexpr (HasQueryBounds<TQueryObject, TDataWrapper>) {
+            auto bounds = GetQueryBounds(QueryObject);
+            standing->HasBounds = true;
+            standing->First = LocateCell(bounds.Min);
+            standing->Last = LocateCell(bounds.Max);
+            ForEachCell(*standing, [&](size_t Cell) {
+                Cells[Cell].push_back(id);
+            });
+        } else {
+            Unbounded.push_back(id);
+        }
+        Queries.emplace(id, std::move(standing));
+        return id;
+    }
+
+    /**
+     * Stops watching the query.
+     * @param Id The id returned by Watch.
+     */
+    void Unwatch(QueryId Id) {
+        auto it = Queries.find(Id);
+        if (it == Queries.end()) {
+            throw std::runtime_error("Query is not watched");
+        }
+        if (it->second->HasBounds) {
+            ForEachCell(*it->second, [&](size_t Cell) {
+                std::erase(Cells[Cell], Id);
+            });
+        } else {
+            std::erase(Unbounded, Id);
+        }
+        Queries.erase(it);
+    }
+
+    /**
+     * Stores the given data in the octree and calls the callbacks of the watched queries it is inside of,
+     * tested with the position the octree stores it at.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) {
+        Octree.Add(DataWrapper);
+        if (Bounds == BoundaryPolicy::Periodic) {
+            auto wrapped = DataWrapper;
+            wrapped.Vector = WrapPoint(DataWrapper.Vector, Octree.GetBoundary());
+            NotifyStored(wrapped);
+        } else {
+            NotifyStored(DataWrapper);
+        }
+    }
+
+    /**
+     * @return Number of object in container.
+     */
+    [[nodiscard]] size_t Size() const {
+        return Octree.Size();
+    }
+
+    /**
+     * @return Number of watched queries.
+     */
+    [[nodiscard]] size_t NrWatched() const {
+        return Queries.size();
+    }
+
+    /**
+     * @return The octree the standing queries are on.
+     */
+    [[nodiscard]] const Tree& GetOctree() const {
+        return Octree;
+    }
+
+private:
+    using CellIndex = std::array<size_t, Dim>;
+
+    struct Standing {
+        std::function<bool(const TDataWrapper&)> IsInside;
+        Callback OnEnter;
+        // The range of cells that the bounds of the query overlaps, empty if First is above Last along an axis.
+        bool HasBounds = false;
+        CellIndex First = {};
+        CellIndex Last = {};
+    };
+
+    /**
+     * @return The cell of the position along every axis, positions outside of the index are clamped
+     * to the cells at its sides.
+     */
+    CellIndex LocateCell(const TVector& Position) const {
+        auto values = ToArray(Position);
+        auto min = ToArray(IndexBoundary.Min);
+        auto max = ToArray(IndexBoundary.Max);
+        CellIndex result;
+        for (size_t axis = 0; axis < Dim; axis++) {
+            float cell = std::floor((values[axis] - min[axis]) / (max[axis] - min[axis]) * static_cast<float>(CellsPerAxis));
+            result[axis] = cell > 0.0f ? static_cast<size_t>(std::min(cell, static_cast<float>(CellsPerAxis - 1))) : 0;
+        }
+        return result;
+    }
+
+    size_t GetCellIndex(const CellIndex& Index) const {
+        size_t cell = 0;
+        for (size_t axis = Dim; axis-- > 0;) {
+            cell = cell * CellsPerAxis + Index[axis];
+        }
+        return cell;
+    }
+
+    void NotifyStored(const TDataWrapper& Data) const {
+        Notify(Cells[GetCellIndex(LocateCell(Data.Vector))], Data);
+        Notify(Unbounded, Data);
+    }
+
+    /**
+     * Takes a copy of the ids and keeps the query alive during its callback, since the callbacks
+     * can watch and unwatch queries.
+     */
+    void Notify(std::vector<QueryId> Ids, const TDataWrapper& Data) const {
+        for (QueryId id : Ids) {
+            auto it = Queries.find(id);
+            if (it != Queries.end() && it->second->IsInside(Data)) {
+                auto standing = it->second;
+                standing->OnEnter(Data);
+            }
+        }
+    }
+
+    template <typename TCallback>
+    void ForEachCell(const Standing& Query, TCallback&& Callback) const {
+        for (size_t axis = 0; axis < Dim; axis++) {
+            if (Query.First[axis] > Query.Last[axis]) {
+                return;
+            }
+        }
+        auto index = Query.First;
+        while (true) {
+            Callback(GetCellIndex(index));
+            size_t axis = 0;
+            while (axis < Dim && index[axis] == Query.Last[axis]) {
+                index[axis] = Query.First[axis];
+                axis++;
+            }
+            if (axis == Dim) {
+                break;
+            }
+            index[axis]++;
+        }
+    }
+
+    Tree Octree;
+    TBoundary IndexBoundary;
+    size_t CellsPerAxis;
+    BoundaryPolicy Bounds;
+    std::vector<std::vector<QueryId>> Cells;
+    std::vector<QueryId> Unbounded;
+    std::unordered_map<QueryId, std::shared_ptr<Standing>> Queries;
+    QueryId NextId = 0;
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "OctreeCpp.h"
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * Query that matches data whose timestamp is within [From, To], used to filter the buckets
+ * that are only partially covered by the time range of a query.
+ */
+template <IsDataWrapper TDataWrapper, typename TTimeOf>
+struct TimeRangeQuery {
+    const TTimeOf* TimeOf = nullptr;
+    double From = 0.0;
+    double To = 0.0;
+
+    bool IsInside(const TDataWrapper& Data) const {
+        double time = (*TimeOf)(Data.Data);
+        return time >= From && time <= To;
+    }
+
+    bool Covers([[maybe_unused]] const Boundary<typename TDataWrapper::VectorType>& Boundary) const {
+        return true;
+    }
+};
+
+/**
+ * A sliding time window of octrees. Data is put in a bucket depending on its timestamp, every
+ * bucket is its own octree and covers BucketDuration of time. The buckets form a ring, so when
+ * newer data arrives the oldest bucket is dropped as a whole instead of removing data point by point.
+ * Queries take a time range and only visit the buckets that overlap it.
+ *
+ * @tparam TVector "Bring your own", Vector class that you want to use. Needs to fufil VectorLike concept.
+ * @tparam TData Data blob that should be paired up with the added object.
+ * @tparam TTimeOf Callable that returns the timestamp of a TData as a double.
+ */
+template <typename TVector, typename TData, typename TTimeOf>
+requires VectorLike<TVector> && std::is_invocable_r_v<double, const TTimeOf&, const TData&>
+class TimeBucketedOctreeCpp {
+public:
+    using Tree = OctreeCpp<TVector, TData>;
+    using TDataWrapper = typename Tree::TDataWrapper;
+    using TBoundary = typename Tree::TBoundary;
+
+    using Sphere = typename Tree::Sphere;
+    using Circle = typename Tree::Circle;
+    using Cylinder = typename Tree::Cylinder;
+    using Box = typename Tree::Box;
+    using Pred = typename Tree::Pred;
+    using All = typename Tree::All;
+
+    /**
+     * Constructor to setup the time bucketed octree.
+     *
+     * @param Boundary min and max X, Y, Z values of every bucket.
+     * @param BucketDuration The length of time every bucket covers, larger than 0.
+     * @param NrBuckets Number of buckets in the window, the window is NrBuckets * BucketDuration long.
+     * @param TimeOf Returns the timestamp of the data.
+     */
+    TimeBucketedOctreeCpp(TBoundary Boundary, double BucketDuration, size_t NrBuckets, TTimeOf TimeOf = {})
+        : BoundaryData(Boundary)
+        , BucketDuration(BucketDuration)
+        , TimeOf(std::move(TimeOf))
+        , Buckets(NrBuckets) {
+        if (!(BucketDuration > 0.0) || NrBuckets == 0) {
+            throw std::runtime_error("Invalid bucket duration or number of buckets");
+        }
+    }
+
+    /**
+     * Stores the given data in the bucket of its timestamp. Moves the window forward if the data
+     * is newer than the newest bucket, which drops the buckets that fall out of the window.
+     * @param DataWrapper
+     */
+    void Add(const TDataWrapper& DataWrapper) requires std::copy_constructible<TData> {
+        Add(TDataWrapper(DataWrapper));
+    }
+
+    /**
+     * Stores the given data in the bucket of its timestamp, moves the payload instead of copying it.
+     * @param DataWrapper
+     */
+    void Add(TDataWrapper&& DataWrapper) {
+        int64_t index = GetBucketIndex(TimeOf(DataWrapper.Data));
+        if (Newest && index <= *Newest - static_cast<int64_t>(Buckets.size())) {
+            throw std::runtime_error("Data is older than the time window");
+        }
+        if (!Newest || index > *Newest) {
+            Newest = index;
+            Expire(GetBucketStart(index - static_cast<int64_t>(Buckets.size()) + 1));
+        }
+        auto& bucket = Buckets[GetSlot(index)];
+        if (!bucket.Octree || bucket.Index != index) {
+            bucket.Index = index;
+            bucket.Octree.emplace(BoundaryData);
+        }
+        bucket.Octree->Add(std::move(DataWrapper));
+    }
+
+    /**
+     * Drops every bucket that only holds data older than Time.
+     * @param Time
+     */
+    void Expire(double Time) {
+        for (auto& bucket : Buckets) {
+            if (bucket.Octree && GetBucketEnd(bucket.Index) <= Time) {
+                bucket.Octree.reset();
+            }
+        }
+    }
+
+    /**
+     * Queries the buckets that overlap the time range and returns all results that returns a hit.
+     * Buckets that are fully inside the time range are queried as is, the data in buckets that are
+     * partially inside is also tested against the time range.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query.
+     * @param From Start of the time range, inclusive.
+     * @param To End of the time range, inclusive.
+     * @return A vector of results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    requires std::copy_constructible<TData>
+    [[nodiscard]] std::vector<TDataWrapper> Query(const TQueryObject& QueryObject, double From, double To) const {
+        std::vector<TDataWrapper> result;
+        ForEachBucket(QueryObject, From, To, [&result](const auto& Octree, const auto& Query) {
+            auto hits = Octree.Query(Query);
+            result.insert(result.end(), std::make_move_iterator(hits.begin()), std::make_move_iterator(hits.end()));
+        });
+        return result;
+    }
+
+    /**
+     * Same as Query but returns references to the stored data instead of copies.
+     * The references stays valid until the bucket holding the data is dropped.
+     *
+     * @tparam TQueryObject The query type passed in.
+     * @param QueryObject The object of TQueryObject with the query.
+     * @param From Start of the time range, inclusive.
+     * @param To End of the time range, inclusive.
+     * @return A vector of references to the results.
+     */
+    template <IsQuery<TDataWrapper> TQueryObject>
+    [[nodiscard]] std::vector<std::reference_wrapper<const TDataWrapper>> QueryRefs(const TQueryObject& QueryObject, double From, double To) const {
+        std::vector<std::reference_wrapper<const TDataWrapper>> result;
+        ForEachBucket(QueryObject, From, To, [&result](const auto& Octree, const auto& Query) {
+            auto hits = Octree.QueryRefs(Query);
+            result.insert(result.end(), hits.begin(), hits.end());
+        });
+        return result;
+    }
+
+    /**
+     * @return Number of object in the live buckets.
+     */
+    [[nodiscard]] size_t Size() const {
+        size_t size = 0;
+        for (const auto& bucket : Buckets) {
+            if (IsLive(bucket)) {
+                size += bucket.Octree->Size();
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @return Number of buckets that holds data.
+     */
+    [[nodiscard]] size_t NrLiveBuckets() const {
+        size_t count = 0;
+        for (const auto& bucket : Buckets) {
+            count += IsLive(bucket);
+        }
+        return count;
+    }
+
+private:
+    struct Bucket {
+        int64_t Index = 0;
+        std::optional<Tree> Octree;
+    };
+
+    int64_t GetBucketIndex(double Time) const {
+        if (!std::isfinite(Time)) {
+            throw std::runtime_error("Invalid timestamp");
+        }
+        return static_cast<int64_t>(std::floor(Time / BucketDuration));
+    }
+
+    size_t GetSlot(int64_t Index) const {
+        auto size = static_cast<int64_t>(Buckets.size());
+        return static_cast<size_t>(((Index % size) + size) % size);
+    }
+
+    double GetBucketStart(int64_t Index) const {
+        return static_cast<double>(Index) * BucketDuration;
+    }
+
+    double GetBucketEnd(int64_t Index) const {
+        return static_cast<double>(Index + 1) * BucketDuration;
+    }
+
+    bool IsLive(const Bucket& Bucket) const {
+        return Bucket.Octree && Newest && Bucket.Index > *Newest - static_cast<int64_t>(Buckets.size());
+    }
+
+    template <typename TQueryObject, typename TCallback>
+    void ForEachBucket(const TQueryObject& QueryObject, double From, double To, TCallback&& Callback) const {
+        using TimeRange = TimeRangeQuery<TDataWrapper, TTimeOf>;
+        for (const auto& bucket : Buckets) {
+            if (!IsLive(bucket)) {
+                continue;
+            }
+            double start = GetBucketStart(bucket.Index);
+            double end = GetBucketEnd(bucket.Index);
+            if (end <= From || start > To) {
+                continue;
+            }
+            if (start >= From && end <= To) {
+                Callback(*bucket.Octree, QueryObject);
+            } else {
+                Callback(*bucket.Octree, AndQuery<TDataWrapper, TQueryObject, TimeRange>{QueryObject, TimeRange{&TimeOf, From, To}});
+            }
+        }
+    }
+
+    TBoundary BoundaryData;
+    double BucketDuration;
+    TTimeOf TimeOf;
+    std::vector<Bucket> Buckets;
+    std::optional<int64_t> Newest;
+};
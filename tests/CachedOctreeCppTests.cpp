@@ -0,0 +1,123 @@
+#include <octree-cpp/CachedOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <string>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+using CachedOctree = CachedOctreeCpp<vec, int>;
+
+TEST(CachedOctreeCppTest, CachedOctreeHitsAndMisses) {
+    CachedOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::mt19937 gen(36);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+
+    auto query = CachedOctree::Sphere{{5.0f, 5.0f, 5.0f}, 2.0f};
+    auto first = octree.Query(query);
+    auto second = octree.Query(query);
+    EXPECT_EQ(octree.Misses(), 1);
+    EXPECT_EQ(octree.Hits(), 1);
+    EXPECT_EQ(first.size(), second.size());
+    EXPECT_EQ(first.size(), octree.GetOctree().Query(query).size());
+
+    // Not cacheable, goes straight to the octree.
+    auto pred = CachedOctree::Pred{[](const auto& Data) { return Data.Data < 10; }};
+    EXPECT_EQ(octree.Query(pred).size(), 10);
+    EXPECT_EQ(octree.Hits() + octree.Misses(), 2);
+    EXPECT_EQ(octree.CacheSize(), 1);
+}
+
+TEST(CachedOctreeCppTest, CachedOctreeInvalidateOnAdd) {
+    CachedOctree octree({{0, 0, 0}, {10, 10, 10}});
+    auto near = CachedOctree::Sphere{{1.0f, 1.0f, 1.0f}, 1.0f};
+    auto far = CachedOctree::Box{{{8.0f, 8.0f, 8.0f}, {9.0f, 9.0f, 9.0f}}};
+    EXPECT_EQ(octree.Query(near).size(), 0);
+    EXPECT_EQ(octree.Query(far).size(), 0);
+    EXPECT_EQ(octree.CacheSize(), 2);
+
+    // Only the query that the new data is inside of is dropped.
+    octree.Add({{1.2f, 1.0f, 1.0f}, 1});
+    EXPECT_EQ(octree.CacheSize(), 1);
+    EXPECT_EQ(octree.Query(near).size(), 1);
+    EXPECT_EQ(octree.Query(far).size(), 0);
+    EXPECT_EQ(octree.Misses(), 3);
+    EXPECT_EQ(octree.Hits(), 1);
+}
+
+TEST(CachedOctreeCppTest, CachedOctreeEviction) {
+    CachedOctree octree({{0, 0, 0}, {10, 10, 10}}, 2);
+    octree.Add({{5.0f, 5.0f, 5.0f}, 1});
+    for (float radius : {1.0f, 2.0f, 3.0f}) {
+        EXPECT_EQ(octree.Query(CachedOctree::Sphere{{5.0f, 5.0f, 5.0f}, radius}).size(), 1);
+    }
+    EXPECT_EQ(octree.CacheSize(), 2);
+    // The least recently used entry is evicted.
+    EXPECT_EQ(octree.Query(CachedOctree::Sphere{{5.0f, 5.0f, 5.0f}, 1.0f}).size(), 1);
+    EXPECT_EQ(octree.Query(CachedOctree::Sphere{{5.0f, 5.0f, 5.0f}, 3.0f}).size(), 1);
+    EXPECT_EQ(octree.Misses(), 4);
+    EXPECT_EQ(octree.Hits(), 1);
+}
+
+TEST(CachedOctreeCppTest, CachedOctreeMoveAndBatchInvalidate) {
+    CachedOctreeCpp<vec, std::string> octree({{0, 0, 0}, {10, 10, 10}});
+    using Oct = decltype(octree);
+    auto near = Oct::Sphere{{1.0f, 1.0f, 1.0f}, 1.0f};
+    auto far = Oct::Sphere{{8.0f, 8.0f, 8.0f}, 1.0f};
+    EXPECT_EQ(octree.Query(near).size(), 0);
+    EXPECT_EQ(octree.Query(far).size(), 0);
+
+    octree.Add({{1.0f, 1.0f, 1.0f}, std::string("moved")});
+    EXPECT_EQ(octree.CacheSize(), 1);
+    auto hits = octree.Query(near);
+    ASSERT_EQ(hits.size(), 1);
+    EXPECT_EQ(hits[0].Data, "moved");
+
+    std::vector<Oct::TDataWrapper> batch;
+    for (int i = 0; i < 20; i++) {
+        batch.push_back({{8.0f, 8.0f, 8.0f}, std::to_string(i)});
+    }
+    octree.AddBatch(batch);
+    EXPECT_EQ(octree.CacheSize(), 1);
+    EXPECT_EQ(octree.Query(far).size(), 20);
+    EXPECT_EQ(octree.Query(near).size(), 1);
+    EXPECT_EQ(octree.Size(), 21);
+}
+
+TEST(CachedOctreeCppTest, CachedOctreeNaNNotCached) {
+    CachedOctree octree({{0, 0, 0}, {10, 10, 10}});
+    octree.Add({{5.0f, 5.0f, 5.0f}, 1});
+    auto query = CachedOctree::Sphere{{5.0f, 5.0f, 5.0f}, std::numeric_limits<float>::quiet_NaN()};
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(octree.Query(query).size(), 0);
+    }
+    EXPECT_EQ(octree.CacheSize(), 0);
+    EXPECT_EQ(octree.Hits() + octree.Misses(), 0);
+}
+
+TEST(CachedOctreeCppTest, CachedOctreePeriodicInvalidate) {
+    CachedOctree octree({{0, 0, 0}, {10, 10, 10}}, 64, SplitPolicy::Midpoint, BoundaryPolicy::Periodic);
+    auto sphere = CachedOctree::Sphere{{1.0f, 1.0f, 1.0f}, 0.5f};
+    auto box = CachedOctree::Box{{{0.0f, 0.0f, 0.0f}, {2.0f, 2.0f, 2.0f}}};
+    EXPECT_EQ(octree.Query(sphere).size(), 0);
+    EXPECT_EQ(octree.Query(box).size(), 0);
+
+    // Stored wrapped at (1.2, 1, 1).
+    octree.Add({{11.2f, 1.0f, 1.0f}, 1});
+    EXPECT_EQ(octree.CacheSize(), 0);
+    EXPECT_EQ(octree.Query(sphere).size(), 1);
+    EXPECT_EQ(octree.Query(box).size(), 1);
+
+    octree.Add(CachedOctree::TDataWrapper{{-8.9f, 1.0f, 1.0f}, 2});
+    EXPECT_EQ(octree.Query(sphere).size(), 2);
+    std::vector<CachedOctree::TDataWrapper> batch{{{1.0f, 21.0f, 1.0f}, 3}};
+    octree.AddBatch(batch);
+    EXPECT_EQ(octree.Query(sphere).size(), octree.GetOctree().Query(sphere).size());
+    EXPECT_EQ(octree.Query(box).size(), 3);
+}
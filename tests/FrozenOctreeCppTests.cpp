@@ -0,0 +1,87 @@
+#include <octree-cpp/OctreeCpp.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <thread>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct vec2d {
+    float x, y;
+    auto operator<=>(const vec2d&) const = default;
+};
+
+using BasicOctree = OctreeCpp<vec, int>;
+using BasicOctree2d = OctreeCpp<vec2d, int>;
+
+TEST(FrozenOctreeCppTest, FrozenOctreeMatchesOctree) {
+    for (auto split : {SplitPolicy::Midpoint, SplitPolicy::Median}) {
+        BasicOctree octree({{0, 0, 0}, {1, 1, 1}}, split, BoundaryPolicy::Grow);
+        std::mt19937 gen(40);
+        std::uniform_real_distribution<float> dis(-3.0f, 3.0f);
+        for (int i = 0; i < 5000; i++) {
+            octree.Add({{dis(gen), dis(gen), dis(gen)}, i});
+        }
+        auto frozen = octree.Freeze();
+        EXPECT_EQ(frozen.Size(), octree.Size());
+        EXPECT_EQ(frozen.GetBoundaries().size(), octree.GetBoundaries().size());
+        EXPECT_EQ(frozen.GetBoundary().Min, octree.GetBoundary().Min);
+
+        auto sphere = BasicOctree::Sphere{{0.5f, -1.0f, 0.0f}, 1.5f};
+        auto expected = octree.Query(sphere);
+        auto hits = frozen.Query(sphere);
+        ASSERT_EQ(hits.size(), expected.size());
+        for (size_t i = 0; i < hits.size(); i++) {
+            EXPECT_EQ(hits[i].Data, expected[i].Data);
+        }
+        EXPECT_EQ(frozen.QueryRefs(BasicOctree::All()).size(), octree.Size());
+    }
+}
+
+TEST(FrozenOctreeCppTest, FrozenOctree2dMoveOnly) {
+    using Oct = OctreeCpp<vec2d, std::unique_ptr<int>>;
+    Oct octree({{0, 0}, {1, 1}});
+    std::mt19937 gen(41);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{dis(gen), dis(gen)}, std::make_unique<int>(i)});
+    }
+    auto circle = Oct::Circle{{0.5f, 0.5f}, 0.25f};
+    auto expected = octree.QueryRefs(circle).size();
+    auto frozen = std::move(octree).Freeze();
+    auto hits = frozen.QueryRefs(circle);
+    EXPECT_EQ(hits.size(), expected);
+    for (const auto& hit : hits) {
+        EXPECT_NE(hit.get().Data, nullptr);
+    }
+}
+
+TEST(FrozenOctreeCppTest, FrozenOctreeConcurrentQueries) {
+    BasicOctree2d octree({{0, 0}, {1, 1}});
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < 10000; i++) {
+        octree.Add({{dis(gen), dis(gen)}, i});
+    }
+    const auto frozen = octree.Freeze();
+    auto circle = BasicOctree2d::Circle{{0.3f, 0.7f}, 0.2f};
+    auto expected = octree.Query(circle).size();
+    std::vector<std::thread> threads;
+    std::vector<size_t> results(4);
+    for (size_t i = 0; i < results.size(); i++) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < 20; j++) {
+                results[i] = frozen.Query(circle).size();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto result : results) {
+        EXPECT_EQ(result, expected);
+    }
+}
@@ -0,0 +1,70 @@
+#include <octree-cpp/GridOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <random>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct vec2d {
+    float x, y;
+    auto operator<=>(const vec2d&) const = default;
+};
+
+using GridOctree = GridOctreeCpp<vec, int>;
+using GridOctree2d = GridOctreeCpp<vec2d, int>;
+
+TEST(GridOctreeCppTest, GridOctreeAdd) {
+    GridOctree octree({{0, 0, 0}, {10, 10, 10}}, 4);
+    octree.Add({{0.0f, 0.0f, 0.0f}, 1});
+    octree.Add({{10.0f, 10.0f, 10.0f}, 2});
+    octree.Add({{2.5f, 5.0f, 7.5f}, 3});
+    EXPECT_EQ(octree.Size(), 3);
+    EXPECT_EQ(octree.NrCells(), 3);
+    EXPECT_EQ(octree.Query(GridOctree::All()).size(), 3);
+    EXPECT_EQ(octree.Query(GridOctree::Box{{{2.5f, 5.0f, 7.5f}, {2.5f, 5.0f, 7.5f}}}).size(), 1);
+    EXPECT_THROW(octree.Add({{11.0f, 0.0f, 0.0f}, 4}), std::runtime_error);
+    EXPECT_THROW(GridOctree({{0, 0, 0}, {10, 10, 10}}, 0), std::runtime_error);
+}
+
+TEST(GridOctreeCppTest, GridOctreeQueryMatchesOctree) {
+    GridOctree grid({{-50, -50, -50}, {50, 50, 50}}, 8);
+    GridOctree::Tree octree({{-50, -50, -50}, {50, 50, 50}});
+    std::mt19937 gen(37);
+    std::uniform_real_distribution<float> dis(-50.0f, 50.0f);
+    std::vector<GridOctree::TDataWrapper> points;
+    for (int i = 0; i < 5000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, i});
+        octree.Add(points.back());
+    }
+    grid.AddBatch(points, true);
+    EXPECT_EQ(grid.Size(), points.size());
+
+    auto sphere = GridOctree::Sphere{{10.0f, -5.0f, 20.0f}, 17.0f};
+    auto box = GridOctree::Box{{{-12.5f, -12.5f, 0.0f}, {25.0f, 12.5f, 12.5f}}};
+    auto pred = GridOctree::Pred{[](const auto& Data) { return Data.Data % 7 == 0; }};
+    EXPECT_EQ(grid.Query(sphere).size(), octree.Query(sphere).size());
+    EXPECT_EQ(grid.QueryRefs(box).size(), octree.QueryRefs(box).size());
+    EXPECT_EQ(grid.Query(pred).size(), octree.Query(pred).size());
+}
+
+TEST(GridOctreeCppTest, GridOctree2dBatchMatchesAdd) {
+    GridOctree2d batch({{0, 0}, {1, 1}}, 5);
+    GridOctree2d single({{0, 0}, {1, 1}}, 5);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    std::vector<GridOctree2d::TDataWrapper> points;
+    for (int i = 0; i < 2000; i++) {
+        points.push_back({{dis(gen), dis(gen)}, i});
+        single.Add(points.back());
+    }
+    batch.AddBatch(points, true);
+    auto circle = GridOctree2d::Circle{{0.4f, 0.6f}, 0.2f};
+    auto expected = single.Query(circle);
+    auto hits = batch.Query(circle);
+    ASSERT_EQ(hits.size(), expected.size());
+    for (size_t i = 0; i < hits.size(); i++) {
+        EXPECT_EQ(hits[i].Data, expected[i].Data);
+    }
+}
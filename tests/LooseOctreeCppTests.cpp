@@ -0,0 +1,70 @@
+#include <octree-cpp/LooseOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <random>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct vec2d {
+    float x, y;
+    auto operator<=>(const vec2d&) const = default;
+};
+
+using LooseOctree = LooseOctreeCpp<vec, int>;
+using LooseOctree2d = LooseOctreeCpp<vec2d, int>;
+
+TEST(LooseOctreeCppTest, LooseOctreeAdd) {
+    LooseOctree octree({{0, 0, 0}, {1, 1, 1}});
+    octree.Add({{{0.4f, 0.4f, 0.4f}, {0.6f, 0.6f, 0.6f}}, 1});
+    EXPECT_EQ(octree.Size(), 1);
+    EXPECT_THROW(octree.Add({{{-2.0f, 0.4f, 0.4f}, {0.6f, 0.6f, 0.6f}}, 1}), std::runtime_error);
+    EXPECT_THROW(LooseOctree({{0, 0, 0}, {1, 1, 1}}, 0.5f), std::runtime_error);
+}
+
+TEST(LooseOctreeCppTest, LooseOctreeQueryExtent) {
+    LooseOctree octree({{0, 0, 0}, {100, 100, 100}});
+    octree.Add({{{10.0f, 10.0f, 10.0f}, {30.0f, 30.0f, 30.0f}}, 1});
+    octree.Add({{{60.0f, 60.0f, 60.0f}, {61.0f, 61.0f, 61.0f}}, 2});
+
+    // The center of the first object is far from the query, but its extent is not.
+    auto hits = octree.Query(LooseOctree::Sphere{{35.0f, 20.0f, 20.0f}, 6.0f});
+    ASSERT_EQ(hits.size(), 1);
+    EXPECT_EQ(hits.front().Data, 1);
+    EXPECT_EQ(octree.Query(LooseOctree::Sphere{{35.0f, 20.0f, 20.0f}, 4.0f}).size(), 0);
+    EXPECT_EQ(octree.Query(LooseOctree::All()).size(), 2);
+}
+
+TEST(LooseOctreeCppTest, LooseOctreeQueryMany) {
+    LooseOctree octree({{0, 0, 0}, {100, 100, 100}}, 1.5f);
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> pos(0.0f, 95.0f);
+    std::uniform_real_distribution<float> size(0.0f, 5.0f);
+    std::vector<LooseOctree::TBoundaryWrapper> objects;
+    for (int i = 0; i < 5000; i++) {
+        vec min = {pos(gen), pos(gen), pos(gen)};
+        vec max = {min.x + size(gen), min.y + size(gen), min.z + size(gen)};
+        objects.push_back({{min, max}, i});
+        octree.Add(objects.back());
+    }
+    EXPECT_EQ(octree.Size(), 5000);
+    EXPECT_GT(octree.GetBoundaries().size(), 1);
+
+    auto query = LooseOctree::Sphere{{50.0f, 50.0f, 50.0f}, 10.0f};
+    size_t expected = 0;
+    for (const auto& object : objects) {
+        expected += query.Covers(object.Bounds) ? 1 : 0;
+    }
+    EXPECT_EQ(octree.Query(query).size(), expected);
+    EXPECT_EQ(octree.QueryRefs(LooseOctree::All()).size(), 5000);
+}
+
+TEST(LooseOctreeCppTest, LooseOctreeQuery2d) {
+    LooseOctree2d octree({{0, 0}, {100, 100}});
+    for (int i = 0; i < 100; i++) {
+        float p = static_cast<float>(i);
+        octree.Add({{{p, p}, {p + 0.5f, p + 0.5f}}, i});
+    }
+    EXPECT_EQ(octree.Query(LooseOctree2d::Circle{{10.0f, 10.0f}, 1.0f}).size(), 2);
+}
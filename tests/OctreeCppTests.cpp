@@ -4,7 +4,10 @@
 
 #include <octree-cpp/OctreeCpp.h>
 #include <gtest/gtest.h>
+#include <mutex>
+#include <ranges>
 #include <random>
+#include <set>
 
 struct vec {
     float x, y, z;
@@ -16,8 +19,14 @@ struct vec2d {
     auto operator<=>(const vec2d&) const = default;
 };
 
+struct vec4 {
+    float x, y, z, t;
+    auto operator<=>(const vec4&) const = default;
+};
+
 using BasicOctree = OctreeCpp<vec, float>;
 using BasicOctree2d = OctreeCpp<vec2d, float>;
+using BasicOctree4d = OctreeCpp<vec4, float>;
 
 TEST(OctreeCppTest, VectorLikeConcept) {
     static_assert(VectorLike<vec>);
@@ -27,6 +36,12 @@ TEST(OctreeCppTest, VectorLikeConcept) {
     static_assert(not VectorLike2D_t<vec>);
     static_assert(not VectorLike2D_t<float>);
     static_assert(not VectorLike3D<float>);
+    static_assert(VectorLike<vec4>);
+    static_assert(VectorLike4D<vec4>);
+    static_assert(not VectorLike4D<vec>);
+    static_assert(Dimensions<vec4>() == 4);
+    static_assert(Dimensions<vec>() == 3);
+    static_assert(Dimensions<vec2d>() == 2);
 }
 
 TEST(OctreeCppTest, BoundaryConcept) {
@@ -328,3 +343,903 @@ TEST(OctreeCppTest, OctreeQueryCircle2dHitNegative) {
     octree.Add({{-5.0f, -5.5f}, 1.0f});
     EXPECT_EQ(octree.Query(SphereQuery<BasicOctree2d::TDataWrapper>{{-20.0f, -70.0f}, 50.0f}).size(), 1);
 }
+
+TEST(OctreeCppTest, DataWrapperNonDefaultConstructible) {
+    struct Payload {
+        explicit Payload(int Value) : Value(Value) {}
+        int Value;
+    };
+    static_assert(not std::default_initializable<Payload>);
+    static_assert(std::is_constructible_v<OctreeCpp<vec, std::unique_ptr<int>>, Boundary<vec>>);
+
+    using Oct = OctreeCpp<vec, Payload>;
+    Oct octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 100; i++) {
+        octree.Add({{0.5f, 0.5f, 0.5f}, Payload(i)});
+    }
+    EXPECT_EQ(octree.Query(Oct::All()).size(), 100);
+    EXPECT_EQ(octree.QueryRefs(Oct::Sphere{{0.5f, 0.5f, 0.5f}, 0.1f}).size(), 100);
+}
+
+TEST(OctreeCppTest, OctreeQueryRefsStable) {
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}});
+    octree.Add({{0.1f, 0.1f, 0.1f}, 1.0f});
+    auto refs = octree.QueryRefs(BasicOctree::All());
+    ASSERT_EQ(refs.size(), 1);
+    const auto* stored = &refs.front().get();
+
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{0.1f, 0.1f, 0.1f}, 2.0f});
+    }
+    auto hits = octree.QueryRefs(BasicOctree::Pred{[](const auto& Data) { return Data.Data < 1.5f; }});
+    ASSERT_EQ(hits.size(), 1);
+    EXPECT_EQ(&hits.front().get(), stored);
+}
+
+TEST(OctreeCppTest, HandleOctree) {
+    struct LargePayload {
+        std::array<float, 64> Values;
+    };
+    std::vector<LargePayload> payloads(100);
+    HandleOctreeCpp<vec> octree({{0, 0, 0}, {1, 1, 1}});
+    for (uint32_t i = 0; i < payloads.size(); i++) {
+        payloads[i].Values.fill(static_cast<float>(i));
+        float pos = static_cast<float>(i) / static_cast<float>(payloads.size());
+        octree.Add({{pos, pos, pos}, {i}});
+    }
+
+    auto hits = octree.Query(HandleOctreeCpp<vec>::Sphere{{0.0f, 0.0f, 0.0f}, 0.05f});
+    ASSERT_EQ(hits.size(), 3);
+    for (const auto& hit : hits) {
+        EXPECT_LT(payloads[hit.Data.Index].Values[0], 3.0f);
+    }
+}
+
+TEST(OctreeCppTest, OctreeAddMoveOnly) {
+    using Oct = OctreeCpp<vec, std::unique_ptr<int>>;
+    Oct octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 100; i++) {
+        octree.Add({{0.5f, 0.5f, 0.5f}, std::make_unique<int>(i)});
+        octree.Emplace({0.25f, 0.25f, 0.25f}, new int(i));
+    }
+    EXPECT_EQ(octree.Size(), 200);
+
+    auto hits = octree.QueryRefs(Oct::Sphere{{0.25f, 0.25f, 0.25f}, 0.1f});
+    ASSERT_EQ(hits.size(), 100);
+    int sum = 0;
+    for (const auto& hit : hits) {
+        sum += *hit.get().Data;
+    }
+    EXPECT_EQ(sum, 4950);
+}
+
+struct Counted {
+    explicit Counted(int Value) : Value(Value) {}
+    Counted(const Counted& Other) : Value(Other.Value) { Copies++; }
+    Counted(Counted&& Other) noexcept : Value(Other.Value) { Moves++; }
+    int Value;
+    static inline int Copies = 0;
+    static inline int Moves = 0;
+};
+
+TEST(OctreeCppTest, OctreeEmplaceInPlace) {
+    using Oct = OctreeCpp<vec, Counted>;
+    Oct octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 100; i++) {
+        const auto& stored = octree.Emplace({0.5f, 0.5f, 0.5f}, i);
+        EXPECT_EQ(stored.Data.Value, i);
+    }
+    EXPECT_EQ(Counted::Copies, 0);
+    EXPECT_EQ(Counted::Moves, 0);
+
+    octree.Add({{0.5f, 0.5f, 0.5f}, Counted(100)});
+    EXPECT_EQ(Counted::Copies, 0);
+    EXPECT_EQ(octree.Size(), 101);
+}
+
+TEST(OctreeCppTest, OctreeEmplaceOutside) {
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}});
+    EXPECT_THROW(octree.Emplace({1.5f, 0.5f, 0.5f}, 1.0f), std::runtime_error);
+    EXPECT_EQ(octree.Size(), 0);
+}
+
+TEST(OctreeCppTest, OctreeEmplaceThrowingConstructor) {
+    struct Throwing {
+        explicit Throwing(int Value) : Value(Value) {
+            if (Value < 0) {
+                throw std::runtime_error("Negative value");
+            }
+        }
+        int Value;
+    };
+    using Oct = OctreeCpp<vec, Throwing>;
+    Oct octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 20; i++) {
+        octree.Emplace({0.5f, 0.5f, 0.5f}, i);
+    }
+    EXPECT_THROW(octree.Emplace({0.5f, 0.5f, 0.5f}, -1), std::runtime_error);
+    EXPECT_EQ(octree.Size(), 20);
+
+    size_t nrData = 0;
+    octree.VisitNodes([&](const Oct::NodeInfo& Info) {
+        nrData += Info.NrData;
+        if (Info.Depth == 0) {
+            EXPECT_EQ(Info.NrObjects, 20);
+        }
+    });
+    EXPECT_EQ(nrData, 20);
+}
+
+TEST(OctreeCppTest, OctreeMedianSplitClustered) {
+    BasicOctree midpoint({{0, 0, 0}, {1000, 1000, 1000}});
+    BasicOctree median({{0, 0, 0}, {1000, 1000, 1000}}, SplitPolicy::Median);
+
+    std::mt19937 gen(42);
+    std::normal_distribution<float> dis(1.0f, 0.01f);
+    for (int i = 0; i < 10000; i++) {
+        BasicOctree::TDataWrapper data = {{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)};
+        midpoint.Add(data);
+        median.Add(data);
+    }
+    EXPECT_EQ(median.Size(), 10000);
+    EXPECT_LT(median.GetBoundaries().size(), midpoint.GetBoundaries().size());
+
+    auto query = BasicOctree::Sphere{{1.0f, 1.0f, 1.0f}, 0.01f};
+    auto expected = median.Query(BasicOctree::Pred{[&query](const auto& Data) { return query.IsInside(Data); }}).size();
+    EXPECT_EQ(median.Query(query).size(), expected);
+    EXPECT_EQ(midpoint.Query(query).size(), expected);
+    EXPECT_EQ(median.Query(BasicOctree::All()).size(), 10000);
+}
+
+TEST(OctreeCppTest, OctreeMedianSplit2d) {
+    BasicOctree2d octree({{0, 0}, {1, 1}}, SplitPolicy::Median);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dis(0.0f, 0.1f);
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{dis(gen), dis(gen)}, 1.0f});
+    }
+    EXPECT_EQ(octree.Query(BasicOctree2d::Circle{{0.05f, 0.05f}, 1.0f}).size(), 1000);
+}
+
+TEST(OctreeCppTest, OctreeGrowBoundary) {
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}}, BoundaryPolicy::Grow);
+    for (int i = 0; i < 100; i++) {
+        float pos = static_cast<float>(i) / 100.0f;
+        octree.Add({{pos, pos, pos}, 1.0f});
+    }
+    auto nrBoundaries = octree.GetBoundaries().size();
+
+    octree.Add({{-3.5f, 10.0f, 0.5f}, 2.0f});
+    octree.Add({{100.0f, -100.0f, 100.0f}, 3.0f});
+    EXPECT_EQ(octree.Size(), 102);
+    EXPECT_GT(octree.GetBoundaries().size(), nrBoundaries);
+
+    auto root = octree.GetBoundaries().front();
+    EXPECT_LE(root.Min.x, -3.5f);
+    EXPECT_LE(root.Min.y, -100.0f);
+    EXPECT_GE(root.Max.x, 100.0f);
+    EXPECT_GE(root.Max.y, 10.0f);
+
+    EXPECT_EQ(octree.Query(BasicOctree::All()).size(), 102);
+    EXPECT_EQ(octree.Query(BasicOctree::Sphere{{0.5f, 0.5f, 0.5f}, 0.1f}).size(), 11);
+    EXPECT_EQ(octree.Query(BasicOctree::Sphere{{-3.5f, 10.0f, 0.5f}, 0.1f}).size(), 1);
+    EXPECT_EQ(octree.Query(BasicOctree::Sphere{{100.0f, -100.0f, 100.0f}, 0.1f}).size(), 1);
+}
+
+TEST(OctreeCppTest, OctreeGrowBoundary2d) {
+    BasicOctree2d octree({{0, 0}, {1, 1}}, SplitPolicy::Median, BoundaryPolicy::Grow);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dis(-50.0f, 50.0f);
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{dis(gen), dis(gen)}, 1.0f});
+    }
+    EXPECT_EQ(octree.Query(BasicOctree2d::Circle{{0.0f, 0.0f}, 100.0f}).size(), 1000);
+}
+
+TEST(OctreeCppTest, OctreeGrowBoundaryInvalid) {
+    BasicOctree octree({{0, 0, 0}, {0, 0, 0}}, BoundaryPolicy::Grow);
+    EXPECT_THROW(octree.Add({{1.0f, 1.0f, 1.0f}, 1.0f}), std::runtime_error);
+    BasicOctree fixed({{0, 0, 0}, {1, 1, 1}});
+    EXPECT_THROW(fixed.Add({{2.0f, 1.0f, 1.0f}, 1.0f}), std::runtime_error);
+}
+
+TEST(OctreeCppTest, OctreeForEachPairWithin) {
+    using Oct = OctreeCpp<vec, int>;
+    Oct octree({{0, 0, 0}, {10, 10, 10}});
+    std::vector<Oct::TDataWrapper> points;
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 2000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, i});
+        octree.Add(points.back());
+    }
+    points.push_back({{5.0f, 5.0f, 5.0f}, 2000});
+    points.push_back({{5.0f, 5.0f, 5.0f}, 2001});
+    octree.Add(points[2000]);
+    octree.Add(points[2001]);
+
+    const float radius = 0.5f;
+    std::set<std::pair<int, int>> expected;
+    for (size_t i = 0; i < points.size(); i++) {
+        for (size_t j = i + 1; j < points.size(); j++) {
+            if (DistanceSquared(points[i].Vector, points[j].Vector) <= radius * radius) {
+                expected.insert({points[i].Data, points[j].Data});
+            }
+        }
+    }
+
+    for (bool parallel : {false, true}) {
+        std::mutex mutex;
+        std::set<std::pair<int, int>> found;
+        size_t calls = 0;
+        octree.ForEachPairWithin(radius, [&](const auto& First, const auto& Second) {
+            std::lock_guard lock(mutex);
+            calls++;
+            found.insert({std::min(First.Data, Second.Data), std::max(First.Data, Second.Data)});
+        }, parallel);
+        EXPECT_EQ(calls, expected.size());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(OctreeCppTest, OctreeForEachPairWithinTwoTrees) {
+    using Oct = OctreeCpp<vec2d, int>;
+    Oct first({{0, 0}, {10, 10}});
+    Oct second({{5, 5}, {20, 20}});
+    std::vector<Oct::TDataWrapper> firstPoints, secondPoints;
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (int i = 0; i < 1000; i++) {
+        firstPoints.push_back({{dis(gen) * 10.0f, dis(gen) * 10.0f}, i});
+        first.Add(firstPoints.back());
+        secondPoints.push_back({{5.0f + dis(gen) * 15.0f, 5.0f + dis(gen) * 15.0f}, i});
+        second.Add(secondPoints.back());
+    }
+
+    const float radius = 0.3f;
+    std::set<std::pair<int, int>> expected;
+    for (const auto& a : firstPoints) {
+        for (const auto& b : secondPoints) {
+            if (DistanceSquared(a.Vector, b.Vector) <= radius * radius) {
+                expected.insert({a.Data, b.Data});
+            }
+        }
+    }
+
+    for (bool parallel : {false, true}) {
+        std::mutex mutex;
+        std::set<std::pair<int, int>> found;
+        size_t calls = 0;
+        first.ForEachPairWithin(second, radius, [&](const auto& First, const auto& Second) {
+            std::lock_guard lock(mutex);
+            calls++;
+            found.insert({First.Data, Second.Data});
+        }, parallel);
+        EXPECT_EQ(calls, expected.size());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(OctreeCppTest, OctreeCopyAndMove) {
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}}, SplitPolicy::Median, BoundaryPolicy::Grow);
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<float> dis(-2.0f, 2.0f);
+    for (int i = 0; i < 1000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    auto query = BasicOctree::Sphere{{0.5f, 0.5f, 0.5f}, 1.0f};
+    auto expected = octree.Query(query).size();
+    auto refs = octree.QueryRefs(query);
+
+    BasicOctree copy = octree;
+    EXPECT_EQ(copy.Query(query).size(), expected);
+    EXPECT_EQ(copy.GetBoundaries().size(), octree.GetBoundaries().size());
+
+    BasicOctree moved = std::move(octree);
+    auto movedRefs = moved.QueryRefs(query);
+    ASSERT_EQ(movedRefs.size(), refs.size());
+    for (size_t i = 0; i < refs.size(); i++) {
+        EXPECT_EQ(&movedRefs[i].get(), &refs[i].get());
+    }
+}
+
+TEST(OctreeCppTest, Octree4dQuery) {
+    BasicOctree4d octree({{0, 0, 0, 0}, {10, 10, 10, 10}});
+    std::vector<BasicOctree4d::TDataWrapper> points;
+    std::mt19937 gen(34);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 5000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+        octree.Add(points.back());
+    }
+    EXPECT_EQ(octree.Size(), points.size());
+    EXPECT_EQ(octree.GetBoundaries().front().NrCorners, 16);
+
+    auto sphere = BasicOctree4d::Sphere{{5.0f, 5.0f, 5.0f, 5.0f}, 3.0f};
+    auto box = BasicOctree4d::Box{{{2.0f, 1.0f, 4.0f, 0.0f}, {6.0f, 8.0f, 5.0f, 3.0f}}};
+    size_t expectedSphere = 0;
+    size_t expectedBox = 0;
+    for (const auto& point : points) {
+        expectedSphere += sphere.IsInside(point);
+        expectedBox += box.IsInside(point);
+    }
+    EXPECT_GT(expectedSphere, 0);
+    EXPECT_GT(expectedBox, 0);
+    EXPECT_EQ(octree.Query(sphere).size(), expectedSphere);
+    EXPECT_EQ(octree.Query(box).size(), expectedBox);
+}
+
+TEST(OctreeCppTest, LocateSection) {
+    EXPECT_EQ(LocateSection(vec2d{1, 1}, vec2d{0, 0}), 3);
+    EXPECT_EQ(LocateSection(vec2d{1, -1}, vec2d{0, 0}), 1);
+    EXPECT_EQ(LocateSection(vec{-1, -1, 1}, vec{0, 0, 0}), 4);
+    EXPECT_EQ(LocateSection(vec4{-1, -1, -1, 1}, vec4{0, 0, 0, 0}), 8);
+    Boundary<vec4> bound{{0, 0, 0, 0}, {2, 2, 2, 2}};
+    auto section = GetBoundaryFromSection(9, bound, bound.GetMidpoint());
+    EXPECT_EQ(section.Min, (vec4{1, 0, 0, 1}));
+    EXPECT_EQ(section.Max, (vec4{2, 1, 1, 2}));
+}
+
+TEST(OctreeCppTest, OctreeQueryRange) {
+    static_assert(std::ranges::input_range<BasicOctree::QueryView<BasicOctree::Sphere>>);
+    static_assert(std::ranges::view<BasicOctree::QueryView<BasicOctree::Sphere>>);
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}}, SplitPolicy::Median);
+    std::mt19937 gen(38);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 5000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+
+    auto query = BasicOctree::Sphere{{5.0f, 5.0f, 5.0f}, 3.0f};
+    auto expected = octree.QueryRefs(query);
+    std::vector<const BasicOctree::TDataWrapper*> found;
+    for (const auto& data : octree.QueryRange(query)) {
+        found.push_back(&data);
+    }
+    ASSERT_EQ(found.size(), expected.size());
+    for (size_t i = 0; i < found.size(); i++) {
+        EXPECT_EQ(found[i], &expected[i].get());
+    }
+
+    // Pagination, every page continues where the last one stopped.
+    auto range = octree.QueryRange(query);
+    std::vector<const BasicOctree::TDataWrapper*> paged;
+    while (true) {
+        size_t before = paged.size();
+        for (const auto& data : std::ranges::ref_view(range) | std::views::take(100)) {
+            paged.push_back(&data);
+        }
+        if (paged.size() == before) {
+            break;
+        }
+    }
+    EXPECT_EQ(paged, found);
+
+    auto filtered = octree.QueryRange(query) | std::views::filter([](const auto& Data) {
+        return static_cast<int>(Data.Data) % 2 == 0;
+    }) | std::views::take(5);
+    size_t count = 0;
+    for (const auto& data : filtered) {
+        EXPECT_EQ(static_cast<int>(data.Data) % 2, 0);
+        count++;
+    }
+    EXPECT_EQ(count, 5);
+
+    BasicOctree empty({{0, 0, 0}, {1, 1, 1}});
+    auto emptyRange = empty.QueryRange(BasicOctree::All());
+    EXPECT_TRUE(emptyRange.begin() == emptyRange.end());
+}
+
+TEST(OctreeCppTest, OctreeDuplicatePoints) {
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 10000; i++) {
+        octree.Add({{0.3f, 0.3f, 0.3f}, static_cast<float>(i)});
+    }
+    octree.Add({{0.9f, 0.9f, 0.9f}, -1.0f});
+    EXPECT_EQ(octree.Size(), 10001);
+    EXPECT_EQ(octree.Query(BasicOctree::Sphere{{0.3f, 0.3f, 0.3f}, 0.01f}).size(), 10000);
+    EXPECT_EQ(octree.Query(BasicOctree::All()).size(), 10001);
+    // The depth is capped so duplicates don't build an endless chain of nodes.
+    EXPECT_LE(octree.GetBoundaries().size(), 100);
+}
+
+TEST(OctreeCppTest, OctreeDuplicatePointsRefsStable) {
+    auto expectStable = [](BasicOctree& Octree) {
+        auto query = BasicOctree::Sphere{{0.3f, 0.3f, 0.3f}, 0.01f};
+        auto refs = Octree.QueryRefs(query);
+        std::vector<std::pair<const BasicOctree::TDataWrapper*, float>> stored;
+        for (const auto& ref : refs) {
+            stored.emplace_back(&ref.get(), ref.get().Data);
+        }
+
+        for (int i = 0; i < 100; i++) {
+            Octree.Add({{0.3f, 0.3f, 0.3f}, -1.0f});
+        }
+        std::vector<BasicOctree::TDataWrapper> batch(1000, {{0.3f, 0.3f, 0.3f}, -2.0f});
+        Octree.AddBatch(batch);
+
+        for (size_t i = 0; i < refs.size(); i++) {
+            EXPECT_EQ(&refs[i].get(), stored[i].first);
+            EXPECT_EQ(refs[i].get().Data, stored[i].second);
+        }
+        auto after = Octree.QueryRefs(query);
+        EXPECT_EQ(after.size(), refs.size() + 1100);
+        std::set<const BasicOctree::TDataWrapper*> addresses;
+        for (const auto& ref : after) {
+            addresses.insert(&ref.get());
+        }
+        for (const auto& [address, value] : stored) {
+            EXPECT_TRUE(addresses.contains(address));
+        }
+    };
+
+    BasicOctree octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 400; i++) {
+        octree.Add({{0.3f, 0.3f, 0.3f}, static_cast<float>(i)});
+    }
+    BasicOctree copy = octree;
+    expectStable(octree);
+    // Blocks of a copy can have less capacity reserved than the original.
+    expectStable(copy);
+    EXPECT_EQ(copy.Size(), 1500);
+}
+
+TEST(OctreeCppTest, OctreeHistogram) {
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::vector<BasicOctree::TDataWrapper> points;
+    std::mt19937 gen(41);
+    std::normal_distribution<float> dis(5.0f, 1.5f);
+    for (int i = 0; i < 20000; i++) {
+        vec position{std::clamp(dis(gen), 0.0f, 10.0f), std::clamp(dis(gen), 0.0f, 10.0f), std::clamp(dis(gen), 0.0f, 10.0f)};
+        points.push_back({position, 1.0f});
+        octree.Add(points.back());
+    }
+    for (float edge : {0.0f, 1.25f, 2.5f, 5.0f, 10.0f}) {
+        points.push_back({{edge, edge, edge}, 1.0f});
+        octree.Add(points.back());
+        points.push_back({{edge, 5.0f, 2.5f}, 1.0f});
+        octree.Add(points.back());
+    }
+
+    BasicOctree grown({{4, 4, 4}, {6, 6, 6}}, SplitPolicy::Median, BoundaryPolicy::Grow);
+    for (const auto& point : points) {
+        grown.Add(point);
+    }
+
+    const size_t resolution = 8;
+    for (auto region : {Boundary<vec>{{0, 0, 0}, {10, 10, 10}}, Boundary<vec>{{2.0f, 3.0f, 1.0f}, {7.0f, 6.0f, 8.0f}}}) {
+        std::vector<size_t> expected(resolution * resolution * resolution, 0);
+        for (const auto& point : points) {
+            if (!IsPointInBoundrary(point.Vector, region)) {
+                continue;
+            }
+            // Cells include their upper edge, the first cell also includes its lower edge.
+            auto cell = [&](float Value, float Min, float Max) {
+                size_t index = 0;
+                while (index + 1 < resolution && Value > Min + (Max - Min) * static_cast<float>(index + 1) / static_cast<float>(resolution)) {
+                    index++;
+                }
+                return index;
+            };
+            expected[cell(point.Vector.x, region.Min.x, region.Max.x) +
+                     cell(point.Vector.y, region.Min.y, region.Max.y) * resolution +
+                     cell(point.Vector.z, region.Min.z, region.Max.z) * resolution * resolution]++;
+        }
+        EXPECT_EQ(octree.Histogram(region, resolution), expected);
+        EXPECT_EQ(grown.Histogram(region, resolution), expected);
+
+        auto sums = octree.Voxelize(region, resolution, 0.0f, [](float& Sum, const auto& Data) {
+            Sum += Data.Data;
+        });
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(static_cast<size_t>(sums[i]), expected[i]);
+        }
+    }
+    EXPECT_THROW(auto _ = octree.Histogram({{0, 0, 0}, {1, 1, 1}}, 0), std::runtime_error);
+}
+
+TEST(OctreeCppTest, OctreeQueryLod) {
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 20000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+
+    auto query = BasicOctree::Sphere{{5.0f, 5.0f, 5.0f}, 4.0f};
+    auto all = octree.Query(query);
+    auto lod = octree.QueryLod(query, 500);
+    EXPECT_EQ(lod.size(), 500);
+    std::set<float> ids;
+    size_t upper = 0;
+    for (const auto& data : lod) {
+        EXPECT_TRUE(query.IsInside(data));
+        ids.insert(data.Data);
+        upper += data.Vector.x > 5.0f;
+    }
+    EXPECT_EQ(ids.size(), lod.size());
+    // The sample is spread out over the query and not taken from one corner.
+    EXPECT_GT(upper, 150);
+    EXPECT_LT(upper, 350);
+
+    EXPECT_EQ(octree.QueryLod(query, all.size() + 10).size(), all.size());
+    EXPECT_EQ(octree.QueryLod(BasicOctree::All(), 100000, 0).size(), 8);
+    EXPECT_TRUE(octree.QueryLod(query, 0).empty());
+}
+
+TEST(OctreeCppTest, OctreeQueryCursor) {
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 20000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+
+    auto cursor = octree.CreateCursor(BasicOctree::Sphere{{2.0f, 2.0f, 2.0f}, 0.5f});
+    EXPECT_GT(cursor.GetAnchorDepth(), 0);
+    EXPECT_EQ(cursor.GetEnteredNodes(), cursor.GetNodes());
+    for (int tick = 0; tick < 50; tick++) {
+        float position = 2.0f + tick * 0.1f;
+        auto query = BasicOctree::Sphere{{position, 2.0f, 2.0f}, 0.5f};
+        auto previous = cursor.GetNodes();
+        cursor.Update(query);
+
+        auto expected = octree.QueryRefs(query);
+        const auto& results = cursor.GetResults();
+        ASSERT_EQ(results.size(), expected.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            EXPECT_EQ(&results[i].get(), &expected[i].get());
+        }
+
+        std::vector<BasicOctree::NodeId> entered;
+        std::vector<BasicOctree::NodeId> exited;
+        std::set_difference(cursor.GetNodes().begin(), cursor.GetNodes().end(), previous.begin(), previous.end(), std::back_inserter(entered));
+        std::set_difference(previous.begin(), previous.end(), cursor.GetNodes().begin(), cursor.GetNodes().end(), std::back_inserter(exited));
+        EXPECT_EQ(cursor.GetEnteredNodes(), entered);
+        EXPECT_EQ(cursor.GetExitedNodes(), exited);
+    }
+
+    // Data added after the cursor was created is found.
+    octree.Add({{7.0f, 2.0f, 2.0f}, -1.0f});
+    cursor.Update(BasicOctree::Sphere{{7.0f, 2.0f, 2.0f}, 0.5f});
+    EXPECT_EQ(cursor.GetResults().size(), octree.Query(BasicOctree::Sphere{{7.0f, 2.0f, 2.0f}, 0.5f}).size());
+}
+
+TEST(OctreeCppTest, OctreeQueryCursorGrownRoot) {
+    // Data on the sides of the nodes, the old roots keep the data on their min side when the root grows.
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<int> grid(-8, 16);
+    auto next = [&]() {
+        return static_cast<float>(grid(gen)) / 8.0f;
+    };
+    for (auto split : {SplitPolicy::Midpoint, SplitPolicy::Median}) {
+        BasicOctree octree({{0, 0, 0}, {1, 1, 1}}, split, BoundaryPolicy::Grow);
+        // Fill the first root before it grows.
+        for (int i = 0; i < 100; i++) {
+            octree.Add({{std::clamp(next(), 0.0f, 1.0f), std::clamp(next(), 0.0f, 1.0f), std::clamp(next(), 0.0f, 1.0f)}, static_cast<float>(i)});
+        }
+        for (int i = 0; i < 200; i++) {
+            octree.Add({{next(), next(), next()}, static_cast<float>(i)});
+        }
+        for (int i = 0; i < 200; i++) {
+            vec min{next(), next(), next()};
+            vec max{min.x + std::abs(next()), min.y + std::abs(next()), min.z + std::abs(next())};
+            auto query = BasicOctree::Box{{min, max}};
+            auto cursor = octree.CreateCursor(query);
+            auto expected = octree.QueryRefs(query);
+            ASSERT_EQ(cursor.GetResults().size(), expected.size());
+        }
+    }
+}
+
+TEST(OctreeCppTest, OctreeVisitNodes) {
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::mt19937 gen(44);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 5000; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+
+    std::vector<BasicOctree::TBoundary> boundaries;
+    size_t nrData = 0;
+    size_t nrLeafs = 0;
+    octree.VisitNodes([&](const BasicOctree::NodeInfo& Info) {
+        boundaries.push_back(Info.Bound);
+        nrData += Info.NrData;
+        nrLeafs += Info.IsLeaf;
+        if (Info.Depth == 0) {
+            EXPECT_EQ(Info.NrObjects, octree.Size());
+        }
+        EXPECT_LE(Info.NrData, Info.NrObjects);
+    });
+    EXPECT_EQ(nrData, octree.Size());
+    EXPECT_GT(nrLeafs, 0);
+    auto expected = octree.GetBoundaries();
+    ASSERT_EQ(boundaries.size(), expected.size());
+    for (size_t i = 0; i < boundaries.size(); i++) {
+        EXPECT_EQ(boundaries[i].Min, expected[i].Min);
+        EXPECT_EQ(boundaries[i].Max, expected[i].Max);
+    }
+
+    // Subtrees below depth 1 are skipped, the count of the visited nodes still covers all data.
+    size_t nrVisited = 0;
+    size_t nrObjects = 0;
+    octree.VisitNodes([&](const BasicOctree::NodeInfo& Info) {
+        EXPECT_LE(Info.Depth, 1);
+        nrVisited++;
+        if (Info.Depth == 1) {
+            nrObjects += Info.NrObjects;
+        } else {
+            nrObjects += Info.NrData;
+        }
+        return Info.Depth < 1;
+    });
+    EXPECT_EQ(nrVisited, 9);
+    EXPECT_EQ(nrObjects, octree.Size());
+}
+
+TEST(OctreeCppTest, OctreePeriodicBoundary) {
+    EXPECT_THROW(BasicOctree({{0, 0, 0}, {0, 1, 1}}, BoundaryPolicy::Periodic), std::runtime_error);
+    BasicOctree wrapped({{0, 0, 0}, {10, 10, 10}}, BoundaryPolicy::Periodic);
+    wrapped.Add({{11.0f, -1.0f, 25.0f}, 1.0f});
+    auto all = wrapped.Query(BasicOctree::All());
+    ASSERT_EQ(all.size(), 1);
+    EXPECT_NEAR(all[0].Vector.x, 1.0f, 1e-5f);
+    EXPECT_NEAR(all[0].Vector.y, 9.0f, 1e-5f);
+    EXPECT_NEAR(all[0].Vector.z, 5.0f, 1e-5f);
+
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}}, BoundaryPolicy::Periodic);
+    std::vector<BasicOctree::TDataWrapper> points;
+    std::mt19937 gen(45);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 5000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+        octree.Add(points.back());
+    }
+
+    // Spheres at the sides and corners find the data on the opposite sides in one query.
+    for (vec midpoint : {vec{0.2f, 5.0f, 5.0f}, vec{9.9f, 9.9f, 0.1f}, vec{0.0f, 0.0f, 0.0f}, vec{5.0f, 5.0f, 5.0f}}) {
+        auto query = octree.MakePeriodicSphere(midpoint, 1.5f);
+        std::set<float> expected;
+        for (const auto& point : points) {
+            for (float dx : {-10.0f, 0.0f, 10.0f}) {
+                for (float dy : {-10.0f, 0.0f, 10.0f}) {
+                    for (float dz : {-10.0f, 0.0f, 10.0f}) {
+                        vec image{point.Vector.x + dx, point.Vector.y + dy, point.Vector.z + dz};
+                        if (DistanceSquared(image, midpoint) <= 1.5f * 1.5f) {
+                            expected.insert(point.Data);
+                        }
+                    }
+                }
+            }
+        }
+        std::set<float> found;
+        for (const auto& hit : octree.QueryRefs(query)) {
+            found.insert(hit.get().Data);
+        }
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(OctreeCppTest, OctreePeriodicPairs) {
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}}, BoundaryPolicy::Periodic);
+    std::vector<BasicOctree::TDataWrapper> points{{{0.1f, 5.0f, 5.0f}, 0.0f}, {{9.9f, 5.0f, 5.0f}, 1.0f}};
+    std::mt19937 gen(45);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 2; i < 2000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (const auto& point : points) {
+        octree.Add(point);
+    }
+
+    const float radius = 0.5f;
+    std::set<std::pair<float, float>> expected;
+    for (size_t i = 0; i < points.size(); i++) {
+        for (size_t j = i + 1; j < points.size(); j++) {
+            if (PeriodicDistanceSquared(points[i].Vector, points[j].Vector, octree.GetBoundary()) <= radius * radius) {
+                expected.insert({points[i].Data, points[j].Data});
+            }
+        }
+    }
+    EXPECT_TRUE(expected.contains({0.0f, 1.0f}));
+    std::set<std::pair<float, float>> found;
+    octree.ForEachPairWithin(radius, [&](const auto& First, const auto& Second) {
+        found.insert({std::min(First.Data, Second.Data), std::max(First.Data, Second.Data)});
+    });
+    EXPECT_EQ(found, expected);
+
+    found.clear();
+    octree.ForEachPairWithin(octree, radius, [&](const auto& First, const auto& Second) {
+        if (First.Data < Second.Data) {
+            found.insert({First.Data, Second.Data});
+        }
+    });
+    EXPECT_EQ(found, expected);
+    BasicOctree fixed({{0, 0, 0}, {10, 10, 10}});
+    EXPECT_THROW(octree.ForEachPairWithin(fixed, radius, [](const auto&, const auto&) {}), std::runtime_error);
+}
+
+TEST(OctreeCppTest, OctreeAddBatch) {
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    std::normal_distribution<float> cluster(3.0f, 0.01f);
+    std::vector<BasicOctree::TDataWrapper> existing;
+    std::vector<BasicOctree::TDataWrapper> batch;
+    for (int i = 0; i < 5000; i++) {
+        existing.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(i)});
+    }
+    for (int i = 0; i < 20000; i++) {
+        batch.push_back({{dis(gen), dis(gen), dis(gen)}, static_cast<float>(-i)});
+        batch.push_back({{cluster(gen), cluster(gen), cluster(gen)}, static_cast<float>(-i - 0.5f)});
+    }
+
+    for (auto split : {SplitPolicy::Midpoint, SplitPolicy::Median}) {
+        for (bool parallel : {false, true}) {
+            BasicOctree expected({{0, 0, 0}, {10, 10, 10}}, split);
+            BasicOctree octree({{0, 0, 0}, {10, 10, 10}}, split);
+            for (const auto& data : existing) {
+                expected.Add(data);
+                octree.Add(data);
+            }
+            for (const auto& data : batch) {
+                expected.Add(data);
+            }
+            octree.AddBatch(batch, parallel);
+            EXPECT_EQ(octree.Size(), expected.Size());
+
+            auto boundaries = octree.GetBoundaries();
+            auto expectedBoundaries = expected.GetBoundaries();
+            ASSERT_EQ(boundaries.size(), expectedBoundaries.size());
+            for (size_t i = 0; i < boundaries.size(); i++) {
+                EXPECT_EQ(boundaries[i].Min, expectedBoundaries[i].Min);
+                EXPECT_EQ(boundaries[i].Max, expectedBoundaries[i].Max);
+            }
+            for (auto query : {BasicOctree::Box{{{0, 0, 0}, {10, 10, 10}}}, BasicOctree::Box{{{2.99f, 2.99f, 2.0f}, {3.0f, 4.0f, 3.01f}}}}) {
+                auto hits = octree.Query(query);
+                auto expectedHits = expected.Query(query);
+                ASSERT_EQ(hits.size(), expectedHits.size());
+                for (size_t i = 0; i < hits.size(); i++) {
+                    EXPECT_EQ(hits[i].Data, expectedHits[i].Data);
+                }
+            }
+        }
+    }
+
+    // Nothing is added when data is outside of a fixed boundary.
+    BasicOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::vector<BasicOctree::TDataWrapper> outside = {{{1, 1, 1}, 1.0f}, {{11, 1, 1}, 2.0f}};
+    EXPECT_THROW(octree.AddBatch(outside), std::runtime_error);
+    EXPECT_EQ(octree.Size(), 0);
+    EXPECT_EQ(octree.Query(BasicOctree::All()).size(), 0);
+
+    BasicOctree growing({{0, 0, 0}, {10, 10, 10}}, BoundaryPolicy::Grow);
+    growing.AddBatch(outside);
+    EXPECT_EQ(growing.Query(BasicOctree::All()).size(), 2);
+}
+
+// Payload that throws when it is moved while Fail is set.
+struct ThrowOnMove {
+    static inline bool Fail = false;
+    int Value = 0;
+
+    ThrowOnMove(int Value) : Value(Value) {
+    }
+    ThrowOnMove(const ThrowOnMove&) = default;
+    ThrowOnMove(ThrowOnMove&& Other) : Value(Other.Value) {
+        if (Fail && Value < 0) {
+            throw std::runtime_error("Move failed");
+        }
+    }
+    ThrowOnMove& operator=(const ThrowOnMove&) = default;
+    ThrowOnMove& operator=(ThrowOnMove&&) = default;
+};
+
+TEST(OctreeCppTest, OctreeAddBatchThrows) {
+    using Oct = OctreeCpp<vec, ThrowOnMove>;
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (bool parallel : {false, true}) {
+        Oct octree({{0, 0, 0}, {10, 10, 10}});
+        for (int i = 0; i < 32; i++) {
+            octree.Add({{dis(gen), dis(gen), dis(gen)}, ThrowOnMove(i)});
+        }
+        // The root is full so the batch goes to new nodes, where the last object fails to move.
+        std::vector<Oct::TDataWrapper> batch;
+        for (int i = 0; i < 100; i++) {
+            batch.push_back({{dis(gen), dis(gen), dis(gen)}, ThrowOnMove(i == 99 ? -1 : 100 + i)});
+        }
+        ThrowOnMove::Fail = true;
+        EXPECT_THROW(octree.AddBatch(batch, parallel), std::runtime_error);
+        ThrowOnMove::Fail = false;
+
+        // The tree is left as it was.
+        auto check = [&](size_t Expected) {
+            EXPECT_EQ(octree.Size(), Expected);
+            EXPECT_EQ(octree.Query(Oct::All()).size(), Expected);
+            size_t nrData = 0;
+            octree.VisitNodes([&](const Oct::NodeInfo& Info) {
+                nrData += Info.NrData;
+                if (Info.Depth == 0) {
+                    EXPECT_EQ(Info.NrObjects, Expected);
+                }
+            });
+            EXPECT_EQ(nrData, Expected);
+        };
+        check(32);
+        octree.AddBatch(batch, parallel);
+        check(132);
+    }
+}
+
+struct Sample {
+    double Time;
+    int Intensity;
+};
+
+struct TimeOfSample {
+    double operator()(const Sample& Data) const {
+        return Data.Time;
+    }
+};
+
+struct IntensityOfSample {
+    int operator()(const Sample& Data) const {
+        return Data.Intensity;
+    }
+};
+
+TEST(OctreeCppTest, OctreeKeyRangeQuery) {
+    using KeyOctree = OctreeCpp<vec, Sample, TimeOfSample, IntensityOfSample>;
+    using ByTime = KeyOctree::KeyRange<TimeOfSample>;
+    using ByIntensity = KeyOctree::KeyRange<IntensityOfSample>;
+    KeyOctree octree({{0, 0, 0}, {10, 10, 10}});
+    KeyOctree batched({{0, 0, 0}, {10, 10, 10}});
+    std::vector<KeyOctree::TDataWrapper> points;
+    std::mt19937 gen(50);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    std::uniform_int_distribution<int> intensity(0, 255);
+    for (int i = 0; i < 20000; i++) {
+        // The time grows along x so that nodes have narrow time bounds.
+        float x = dis(gen);
+        points.push_back({{x, dis(gen), dis(gen)}, {x * 100.0 + i % 7, intensity(gen)}});
+        octree.Add(points.back());
+    }
+    batched.AddBatch(points);
+
+    size_t nrTested = 0;
+    auto timeRange = ByTime{150.0, 300.0};
+    auto intensityRange = ByIntensity{10, 20};
+    auto query = KeyOctree::And<KeyOctree::Sphere, KeyOctree::And<ByTime, ByIntensity>>{{{2.0f, 5.0f, 5.0f}, 4.0f}, {timeRange, intensityRange}};
+    auto pred = KeyOctree::Pred{[&](const KeyOctree::TDataWrapper& Data) {
+        nrTested++;
+        return timeRange.IsInside(Data) && intensityRange.IsInside(Data);
+    }};
+    auto hits = octree.Query(query);
+    auto batchedHits = batched.Query(query);
+    auto expected = octree.Query(KeyOctree::And<KeyOctree::Sphere, KeyOctree::Pred>{query.Query1, pred});
+    ASSERT_EQ(hits.size(), expected.size());
+    ASSERT_EQ(batchedHits.size(), expected.size());
+    for (size_t i = 0; i < hits.size(); i++) {
+        EXPECT_EQ(hits[i].Data.Time, expected[i].Data.Time);
+        EXPECT_EQ(batchedHits[i].Data.Time, expected[i].Data.Time);
+    }
+
+    // Nodes outside of the time range are skipped, the data in them is never tested.
+    size_t nrTestedWithKeys = 0;
+    auto counted = KeyOctree::Pred{[&](const KeyOctree::TDataWrapper&) {
+        nrTestedWithKeys++;
+        return true;
+    }};
+    EXPECT_EQ(octree.Query(KeyOctree::And<decltype(query), KeyOctree::Pred>{query, counted}).size(), expected.size());
+    EXPECT_LT(nrTestedWithKeys * 4, nrTested);
+
+    // Or and Not can't skip nodes that the other side or the inverted query needs.
+    auto either = KeyOctree::Or<ByTime, ByIntensity>{timeRange, intensityRange};
+    size_t nrEither = 0;
+    for (const auto& point : points) {
+        nrEither += either.IsInside(point);
+    }
+    EXPECT_EQ(octree.Query(either).size(), nrEither);
+    EXPECT_EQ(octree.Query(KeyOctree::Not<ByTime>{timeRange}).size(), points.size() - octree.Query(timeRange).size());
+}
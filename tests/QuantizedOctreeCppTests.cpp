@@ -0,0 +1,150 @@
+#include <octree-cpp/QuantizedOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <set>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct vec2d {
+    float x, y;
+    auto operator<=>(const vec2d&) const = default;
+};
+
+using QuantizedOctree = QuantizedOctreeCpp<vec, DataHandle>;
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeAdd) {
+    QuantizedOctree octree({{0, 0, 0}, {1, 1, 1}});
+    octree.Add({{0.5f, 0.5f, 0.5f}, {1}});
+    EXPECT_EQ(octree.Size(), 1);
+    EXPECT_THROW(octree.Add({{1.5f, 0.5f, 0.5f}, {1}}), std::runtime_error);
+    EXPECT_EQ(octree.Size(), 1);
+}
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeErrorBound) {
+    QuantizedOctree octree({{-100, -100, -100}, {100, 100, 100}});
+    std::vector<vec> positions;
+    std::mt19937 gen(13);
+    std::uniform_real_distribution<float> dis(-100.0f, 100.0f);
+    for (uint32_t i = 0; i < 10000; i++) {
+        positions.push_back({dis(gen), dis(gen), dis(gen)});
+        octree.Add({positions.back(), {i}});
+    }
+
+    auto all = octree.Query(QuantizedOctree::All());
+    ASSERT_EQ(all.size(), 10000);
+    const float maxError = octree.MaxError();
+    for (const auto& data : all) {
+        const auto& position = positions[data.Data.Index];
+        EXPECT_LE(std::abs(position.x - data.Vector.x), maxError);
+        EXPECT_LE(std::abs(position.y - data.Vector.y), maxError);
+        EXPECT_LE(std::abs(position.z - data.Vector.z), maxError);
+    }
+}
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeDecodeInsideNode) {
+    // With this boundary min + MaxCoord * (size / MaxCoord) rounds one float step past max,
+    // few enough points that they all stay in the root.
+    const float min = -82.9911575f;
+    const float max = 65.9206696f;
+    QuantizedOctree octree({{min, min, min}, {max, max, max}});
+    std::mt19937 gen(32);
+    std::uniform_real_distribution<float> dis(min, max);
+    for (uint32_t i = 0; i < 20; i++) {
+        octree.Add({{dis(gen), dis(gen), dis(gen)}, {i}});
+    }
+    octree.Add({{max, max, max}, {20}});
+    octree.Add({{min, max, min}, {21}});
+    auto all = octree.Query(QuantizedOctree::All());
+    ASSERT_EQ(all.size(), octree.Size());
+    for (const auto& data : all) {
+        ASSERT_TRUE(IsPointInBoundrary(data.Vector, octree.GetBoundaries().front()));
+        // The nodes the decoded position is inside of are the ones that are visited, so nothing is dropped.
+        ASSERT_FALSE(octree.Query(QuantizedOctree::Sphere{data.Vector, 0.0f}).empty());
+    }
+}
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeConservativeQuery) {
+    QuantizedOctreeCpp<vec, DataHandle, uint8_t> octree({{0, 0, 0}, {10, 10, 10}});
+    std::vector<vec> positions;
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (uint32_t i = 0; i < 5000; i++) {
+        positions.push_back({dis(gen), dis(gen), dis(gen)});
+        octree.Add({positions.back(), {i}});
+    }
+
+    const vec midpoint = {5.0f, 5.0f, 5.0f};
+    const float radius = 2.0f;
+    auto hits = octree.Query(QuantizedOctree::Sphere{midpoint, radius + octree.MaxError() * std::sqrt(3.0f)});
+    std::set<uint32_t> found;
+    for (const auto& hit : hits) {
+        found.insert(hit.Data.Index);
+    }
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        if (DistanceSquared(positions[i], midpoint) <= radius * radius) {
+            EXPECT_TRUE(found.contains(i));
+        }
+    }
+}
+
+TEST(QuantizedOctreeCppTest, QuantizedOctree2d) {
+    QuantizedOctreeCpp<vec2d, int> octree({{0, 0}, {1, 1}});
+    for (int i = 0; i < 100; i++) {
+        octree.Add({{0.25f, 0.25f}, i});
+        octree.Add({{0.75f, 0.75f}, i});
+    }
+    EXPECT_EQ(octree.Query(QuantizedOctreeCpp<vec2d, int>::Circle{{0.25f, 0.25f}, 0.01f}).size(), 100);
+    EXPECT_EQ(octree.Size(), 200);
+}
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeDuplicates) {
+    QuantizedOctree octree({{0, 0, 0}, {1, 1, 1}});
+    for (uint32_t i = 0; i < 100000; i++) {
+        octree.Add({{0.3f, 0.3f, 0.3f}, {i}});
+    }
+    octree.Add({{0.9f, 0.9f, 0.9f}, {100000}});
+    EXPECT_EQ(octree.Size(), 100001);
+    EXPECT_LE(octree.GetBoundaries().size(), 18);
+
+    auto hits = octree.Query(QuantizedOctree::Sphere{{0.3f, 0.3f, 0.3f}, octree.MaxError() * 2});
+    ASSERT_EQ(hits.size(), 100000);
+    std::set<uint32_t> found;
+    for (const auto& hit : hits) {
+        found.insert(hit.Data.Index);
+    }
+    EXPECT_EQ(found.size(), 100000);
+    EXPECT_EQ(octree.Query(QuantizedOctree::All()).size(), 100001);
+}
+
+struct CountedCopies {
+    CountedCopies(int Value) : Value(Value) {}
+    CountedCopies(const CountedCopies& Other) : Value(Other.Value) { Copies++; }
+    CountedCopies(CountedCopies&&) = default;
+    int Value;
+    static inline size_t Copies = 0;
+};
+
+TEST(QuantizedOctreeCppTest, QuantizedOctreeCopiesOnlyHits) {
+    using Counted = CountedCopies;
+    using Oct = QuantizedOctreeCpp<vec, Counted>;
+    Oct octree({{0, 0, 0}, {1, 1, 1}});
+    for (int i = 0; i < 1000; i++) {
+        float pos = static_cast<float>(i) / 1000.0f;
+        octree.Add({{pos, pos, pos}, Counted(i)});
+    }
+
+    Counted::Copies = 0;
+    auto hits = octree.Query(Oct::Sphere{{0.5f, 0.5f, 0.5f}, 0.01f});
+    ASSERT_FALSE(hits.empty());
+    // One copy for every hit and one for the probe the positions are tested with.
+    EXPECT_LE(Counted::Copies, hits.size() + 1);
+
+    auto predHits = octree.Query(Oct::Pred{[](const Oct::TDataWrapper& Data) {
+        return Data.Data.Value < 10;
+    }});
+    EXPECT_EQ(predHits.size(), 10);
+}
@@ -0,0 +1,88 @@
+#include <octree-cpp/ShardedOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+using Wrapper = DataWrapper<vec, int>;
+using SphereAndBox = AndQuery<Wrapper, SphereQuery<Wrapper>, BoxQuery<Wrapper>>;
+using ShardedOctree = ShardedOctreeCpp<vec, int, SphereAndBox>;
+
+// Only the built in queries and the listed ones can be sent to the shards.
+template <typename TQuery>
+concept CanQuery = requires(ShardedOctree& Octree, const TQuery& Query) { Octree.Query(Query); };
+static_assert(CanQuery<SphereAndBox>);
+static_assert(!CanQuery<OrQuery<Wrapper, SphereQuery<Wrapper>, BoxQuery<Wrapper>>>);
+
+TEST(ShardedOctreeCppTest, ShardedOctreeAdd) {
+    EXPECT_THROW(ShardedOctree({{0, 0, 0}, {1, 1, 1}}, 0), std::runtime_error);
+    ShardedOctree octree({{0, 0, 0}, {1, 1, 1}}, 3);
+    EXPECT_EQ(octree.NrShards(), 3);
+    octree.Add({{0.5f, 0.5f, 0.5f}, 1});
+    octree.Add({{0.0f, 1.0f, 0.0f}, 2});
+    EXPECT_THROW(octree.Add({{2.0f, 0.5f, 0.5f}, 3}), std::runtime_error);
+    EXPECT_EQ(octree.Size(), 2);
+    EXPECT_EQ(octree.Query(ShardedOctree::All()).size(), 2);
+}
+
+TEST(ShardedOctreeCppTest, ShardedOctreeQuery) {
+    std::vector<ShardedOctree::TDataWrapper> points;
+    std::mt19937 gen(46);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 20000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, i});
+    }
+    points.push_back({{5.0f, 5.0f, 5.0f}, -1});
+    ShardedOctree::Tree reference({{0, 0, 0}, {10, 10, 10}});
+    for (const auto& point : points) {
+        reference.Add(point);
+    }
+
+    auto ids = [](const std::vector<ShardedOctree::TDataWrapper>& Data) {
+        std::vector<int> result;
+        for (const auto& data : Data) {
+            result.push_back(data.Data);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    for (size_t nrShards : {1, 3, 8, 11}) {
+        ShardedOctree octree({{0, 0, 0}, {10, 10, 10}}, nrShards);
+        for (const auto& point : points) {
+            octree.Add(point);
+        }
+        EXPECT_EQ(ids(octree.Query(ShardedOctree::All())), ids(reference.Query(ShardedOctree::All())));
+        auto sphere = ShardedOctree::Sphere{{5.0f, 5.0f, 5.0f}, 2.0f};
+        EXPECT_EQ(ids(octree.Query(sphere)), ids(reference.Query(sphere)));
+        auto box = ShardedOctree::Box{{{1.0f, 2.0f, 3.0f}, {2.0f, 8.0f, 4.0f}}};
+        EXPECT_EQ(ids(octree.Query(box)), ids(reference.Query(box)));
+        auto both = SphereAndBox{sphere, ShardedOctree::Box{{{4.0f, 4.0f, 4.0f}, {10.0f, 10.0f, 10.0f}}}};
+        EXPECT_EQ(ids(octree.Query(both)), ids(reference.Query(both)));
+    }
+}
+
+// Fails in the shards, which stops the worker process that runs it.
+struct FailingQuery {
+    bool IsInside(const Wrapper&) const {
+        throw std::runtime_error("Query failed");
+    }
+    bool Covers(const Boundary<vec>&) const {
+        return true;
+    }
+};
+
+TEST(ShardedOctreeCppTest, ShardedOctreeLostShard) {
+    ShardedOctreeCpp<vec, int, FailingQuery> octree({{0, 0, 0}, {1, 1, 1}}, 4);
+    for (int i = 0; i < 100; i++) {
+        octree.Add({{i / 100.0f, 0.5f, 0.5f}, i});
+    }
+    EXPECT_THROW((void)octree.Query(FailingQuery()), std::runtime_error);
+    // The shards that did answer are not read again, every later call throws.
+    EXPECT_THROW((void)octree.Query(ShardedOctree::All()), std::runtime_error);
+    EXPECT_THROW(octree.Add({{0.5f, 0.5f, 0.5f}, 1}), std::runtime_error);
+    EXPECT_THROW(octree.Flush(), std::runtime_error);
+}
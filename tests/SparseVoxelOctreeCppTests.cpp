@@ -0,0 +1,168 @@
+#include <octree-cpp/SparseVoxelOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct vec2d {
+    float x, y;
+    auto operator<=>(const vec2d&) const = default;
+};
+
+using VoxelOctree = SparseVoxelOctreeCpp<vec>;
+
+TEST(SparseVoxelOctreeCppTest, VoxelOctreeSet) {
+    EXPECT_THROW(VoxelOctree({{0, 0, 0}, {1, 1, 1}}, 0), std::runtime_error);
+    EXPECT_THROW(VoxelOctree({{0, 0, 0}, {1, 1, 1}}, 25), std::runtime_error);
+    VoxelOctree octree({{0, 0, 0}, {16, 16, 16}}, 4);
+    EXPECT_FALSE(octree.IsOccupied({0.5f, 0.5f, 0.5f}));
+    octree.Set({0.5f, 0.5f, 0.5f});
+    octree.Set({0.9f, 0.1f, 0.2f});
+    octree.Set({16.0f, 16.0f, 16.0f});
+    EXPECT_THROW(octree.Set({17.0f, 0.0f, 0.0f}), std::runtime_error);
+    EXPECT_EQ(octree.NrVoxels(), 2);
+    EXPECT_TRUE(octree.IsOccupied({0.1f, 0.9f, 0.9f}));
+    EXPECT_TRUE(octree.IsOccupied({15.5f, 15.5f, 15.5f}));
+    EXPECT_FALSE(octree.IsOccupied({1.5f, 0.5f, 0.5f}));
+    EXPECT_FALSE(octree.IsOccupied({-1.0f, 0.5f, 0.5f}));
+
+    SparseVoxelOctreeCpp<vec2d> octree2d({{0, 0}, {1, 1}}, 1);
+    octree2d.Set({0.75f, 0.25f});
+    EXPECT_TRUE(octree2d.IsOccupied({0.6f, 0.4f}));
+    EXPECT_FALSE(octree2d.IsOccupied({0.4f, 0.4f}));
+}
+
+TEST(SparseVoxelOctreeCppTest, VoxelOctreeCompact) {
+    VoxelOctree octree({{0, 0, 0}, {32, 32, 32}}, 5);
+    // A filled floor and a few random voxels above it.
+    for (int x = 0; x < 32; x++) {
+        for (int y = 0; y < 32; y++) {
+            for (int z = 0; z < 8; z++) {
+                octree.Set({x + 0.5f, y + 0.5f, z + 0.5f});
+            }
+        }
+    }
+    // Every level of the floor is the same subtree repeated, at most one node per level is left.
+    auto floor = octree;
+    floor.Compact();
+    EXPECT_LE(floor.NrNodes(), 5);
+    EXPECT_EQ(floor.NrVoxels(), 32 * 32 * 8);
+
+    std::set<std::array<int, 3>> voxels;
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> dis(0, 31);
+    for (int i = 0; i < 50; i++) {
+        std::array<int, 3> voxel{dis(gen), dis(gen), dis(gen)};
+        voxels.insert(voxel);
+        octree.Set({voxel[0] + 0.5f, voxel[1] + 0.5f, voxel[2] + 0.5f});
+    }
+    auto isFilled = [&](int x, int y, int z) {
+        return z < 8 || voxels.contains({x, y, z});
+    };
+    auto check = [&]() {
+        for (int x = 0; x < 32; x++) {
+            for (int y = 0; y < 32; y++) {
+                for (int z = 0; z < 32; z++) {
+                    ASSERT_EQ(octree.IsOccupied({x + 0.5f, y + 0.5f, z + 0.5f}), isFilled(x, y, z));
+                }
+            }
+        }
+    };
+    check();
+    auto nrVoxels = octree.NrVoxels();
+    auto memory = octree.MemoryUsage();
+    octree.Compact();
+    EXPECT_LT(octree.MemoryUsage() * 2, memory);
+    EXPECT_EQ(octree.NrVoxels(), nrVoxels);
+    check();
+
+    // Filling voxels after compacting does not change the shared subtrees, only the path to the
+    // voxel is copied once and the copies are changed in place.
+    auto nrNodes = octree.NrNodes();
+    octree.Set({31.5f, 31.5f, 31.5f});
+    EXPECT_LE(octree.NrNodes(), nrNodes + 5);
+    nrNodes = octree.NrNodes();
+    octree.Set({30.5f, 31.5f, 31.5f});
+    octree.Set({30.5f, 30.5f, 31.5f});
+    EXPECT_EQ(octree.NrNodes(), nrNodes);
+    octree.Set({0.5f, 0.5f, 31.5f});
+    voxels.insert({31, 31, 31});
+    voxels.insert({30, 31, 31});
+    voxels.insert({30, 30, 31});
+    voxels.insert({0, 0, 31});
+    check();
+}
+
+TEST(SparseVoxelOctreeCppTest, VoxelOctreeBoxAndRay) {
+    VoxelOctree octree({{0, 0, 0}, {10, 10, 10}}, 6);
+    std::vector<vec> points;
+    std::mt19937 gen(47);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    for (int i = 0; i < 2000; i++) {
+        points.push_back({dis(gen), dis(gen), dis(gen)});
+        octree.Set(points.back());
+    }
+
+    Boundary<vec> region{{2.0f, 3.0f, 4.0f}, {4.0f, 5.0f, 6.5f}};
+    auto voxels = octree.QueryVoxels(region);
+    EXPECT_EQ(octree.IsAnyOccupied(region), !voxels.empty());
+    for (const auto& voxel : voxels) {
+        EXPECT_LE(DistanceSquared(voxel, region), 0.0f);
+        EXPECT_TRUE(octree.IsOccupied(voxel.GetMidpoint()));
+    }
+    for (const auto& point : points) {
+        if (IsPointInBoundrary(point, {{2.2f, 3.2f, 4.2f}, {3.8f, 4.8f, 6.3f}})) {
+            EXPECT_TRUE(std::any_of(voxels.begin(), voxels.end(), [&](const auto& voxel) {
+                return IsPointInBoundrary(point, voxel);
+            }));
+        }
+    }
+    EXPECT_FALSE(VoxelOctree({{0, 0, 0}, {10, 10, 10}}, 6).IsAnyOccupied(region));
+
+    // Marching along the ray in small steps finds the same voxel as the raycast.
+    vec origin{0.1f, 0.2f, 0.3f};
+    for (vec direction : {vec{1.0f, 0.9f, 0.8f}, vec{0.0f, 1.0f, 0.0f}, vec{1.0f, 0.0f, 0.3f}}) {
+        std::optional<float> expected;
+        for (float t = 0.0f; t < 20.0f; t += 0.001f) {
+            vec point{origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t};
+            if (octree.IsOccupied(point)) {
+                expected = t;
+                break;
+            }
+        }
+        auto hit = octree.Raycast(origin, direction);
+        ASSERT_EQ(hit.has_value(), expected.has_value());
+        if (hit) {
+            EXPECT_NEAR(*hit, *expected, 0.002f);
+        }
+    }
+    EXPECT_FALSE(octree.Raycast({-1.0f, -1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}).has_value());
+}
+
+TEST(SparseVoxelOctreeCppTest, VoxelOctreeQueryMatchesSet) {
+    // At high depth the voxel edges are close to float precision, box queries have to find the voxel Set filled.
+    for (size_t depth : {10, 20, 24}) {
+        VoxelOctree octree({{-3.3f, -3.3f, -3.3f}, {7.1f, 7.1f, 7.1f}}, depth);
+        std::mt19937 gen(47);
+        std::uniform_real_distribution<float> dis(-3.3f, 7.1f);
+        std::vector<vec> points;
+        for (int i = 0; i < 5000; i++) {
+            points.push_back({dis(gen), dis(gen), dis(gen)});
+            octree.Set(points.back());
+        }
+        for (const auto& point : points) {
+            ASSERT_TRUE(octree.IsOccupied(point));
+            ASSERT_TRUE(octree.IsAnyOccupied({point, point}));
+            ASSERT_FALSE(octree.QueryVoxels({point, point}).empty());
+        }
+    }
+    VoxelOctree octree({{0, 0, 0}, {8, 8, 8}}, 3);
+    octree.Set({0.5f, 0.5f, 0.5f});
+    EXPECT_FALSE(octree.IsAnyOccupied({{9, 9, 9}, {10, 10, 10}}));
+    EXPECT_FALSE(octree.IsAnyOccupied({{1, 1, 1}, {0, 0, 0}}));
+    EXPECT_TRUE(octree.IsAnyOccupied({{-1, -1, -1}, {1, 1, 1}}));
+}
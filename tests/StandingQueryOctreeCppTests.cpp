@@ -0,0 +1,130 @@
+#include <octree-cpp/StandingQueryOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <random>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+using StandingOctree = StandingQueryOctreeCpp<vec, int>;
+
+TEST(StandingQueryOctreeCppTest, StandingQueryEnter) {
+    StandingOctree octree({{0, 0, 0}, {10, 10, 10}}, 8);
+    octree.Add({{1.0f, 1.0f, 1.0f}, 1});
+    std::vector<int> entered;
+    auto id = octree.Watch(StandingOctree::Sphere{{1.0f, 1.0f, 1.0f}, 1.0f}, [&](const auto& Data) {
+        entered.push_back(Data.Data);
+    });
+    // Data that is already inside is reported when the query is watched.
+    EXPECT_EQ(entered, std::vector<int>{1});
+    octree.Add({{1.5f, 1.0f, 1.0f}, 2});
+    octree.Add({{5.0f, 5.0f, 5.0f}, 3});
+    EXPECT_EQ(entered, (std::vector<int>{1, 2}));
+
+    octree.Unwatch(id);
+    octree.Add({{1.0f, 1.5f, 1.0f}, 4});
+    EXPECT_EQ(entered, (std::vector<int>{1, 2}));
+    EXPECT_EQ(octree.NrWatched(), 0);
+    EXPECT_THROW(octree.Unwatch(id), std::runtime_error);
+    EXPECT_THROW(StandingOctree({{0, 0, 0}, {1, 1, 1}}, 0), std::runtime_error);
+}
+
+TEST(StandingQueryOctreeCppTest, StandingQueryManyQueries) {
+    StandingOctree octree({{0, 0, 0}, {10, 10, 10}});
+    std::mt19937 gen(49);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    std::vector<std::function<bool(const StandingOctree::TDataWrapper&)>> queries;
+    std::vector<std::vector<int>> entered(1001);
+    std::vector<StandingOctree::QueryId> ids;
+    for (int i = 0; i < 1000; i++) {
+        auto watch = [&](const auto& Query) {
+            queries.push_back([Query](const auto& Data) { return Query.IsInside(Data); });
+            ids.push_back(octree.Watch(Query, [&entered, i](const auto& Data) {
+                entered[i].push_back(Data.Data);
+            }));
+        };
+        vec min{dis(gen), dis(gen), dis(gen)};
+        if (i % 2 == 0) {
+            watch(StandingOctree::Sphere{min, size(gen)});
+        } else {
+            watch(StandingOctree::Box{{min, {min.x + size(gen), min.y + size(gen), min.z + size(gen)}}});
+        }
+    }
+    // Queries without bounds are checked for all data.
+    queries.push_back([](const auto& Data) { return Data.Data % 100 == 0; });
+    ids.push_back(octree.Watch(StandingOctree::Pred{[](const auto& Data) { return Data.Data % 100 == 0; }}, [&entered](const auto& Data) {
+        entered[1000].push_back(Data.Data);
+    }));
+
+    std::vector<StandingOctree::TDataWrapper> points;
+    for (int i = 0; i < 5000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, i});
+        octree.Add(points.back());
+    }
+    for (size_t i = 0; i < queries.size(); i++) {
+        std::vector<int> expected;
+        for (const auto& point : points) {
+            if (queries[i](point)) {
+                expected.push_back(point.Data);
+            }
+        }
+        EXPECT_EQ(entered[i], expected);
+    }
+}
+
+TEST(StandingQueryOctreeCppTest, StandingQueryEmptyBounds) {
+    StandingOctree octree({{0, 0, 0}, {10, 10, 10}}, 8);
+    int entered = 0;
+    auto inverted = octree.Watch(StandingOctree::Box{{{6, 6, 6}, {2, 2, 2}}}, [&](const auto&) {
+        entered++;
+    });
+    auto partly = octree.Watch(StandingOctree::Box{{{1, 6, 1}, {9, 2, 9}}}, [&](const auto&) {
+        entered++;
+    });
+    octree.Add({{4.0f, 4.0f, 4.0f}, 1});
+    EXPECT_EQ(entered, 0);
+    octree.Unwatch(inverted);
+    octree.Unwatch(partly);
+    EXPECT_EQ(octree.NrWatched(), 0);
+}
+
+TEST(StandingQueryOctreeCppTest, StandingQueryWatchInCallback) {
+    StandingOctree octree({{0, 0, 0}, {10, 10, 10}}, 8);
+    std::vector<int> entered;
+    StandingOctree::QueryId once = 0;
+    once = octree.Watch(StandingOctree::Sphere{{1.0f, 1.0f, 1.0f}, 2.0f}, [&](const auto& Data) {
+        entered.push_back(Data.Data);
+        // Stops watching itself and starts many queries in the same cell, which grows the list of the cell.
+        octree.Unwatch(once);
+        for (int i = 0; i < 100; i++) {
+            octree.Watch(StandingOctree::Sphere{{1.0f, 1.0f, 1.0f}, 2.0f}, [&, i](const auto& Data) {
+                if (i == 0) {
+                    entered.push_back(Data.Data * 10);
+                }
+            });
+        }
+    });
+    octree.Add({{1.0f, 1.0f, 1.0f}, 1});
+    // The new queries see the data that is already added when they are watched.
+    EXPECT_EQ(entered, (std::vector<int>{1, 10}));
+    octree.Add({{1.5f, 1.0f, 1.0f}, 2});
+    EXPECT_EQ(entered, (std::vector<int>{1, 10, 20}));
+    EXPECT_EQ(octree.NrWatched(), 100);
+}
+
+TEST(StandingQueryOctreeCppTest, StandingQueryPeriodic) {
+    StandingOctree octree({{0, 0, 0}, {10, 10, 10}}, 8, SplitPolicy::Midpoint, BoundaryPolicy::Periodic);
+    std::vector<int> entered;
+    octree.Watch(StandingOctree::Sphere{{1.2f, 1.0f, 1.0f}, 0.5f}, [&](const auto& Data) {
+        entered.push_back(Data.Data);
+    });
+    // Data is tested at the position the octree wraps it to.
+    octree.Add({{11.2f, 1.0f, 1.0f}, 1});
+    octree.Add({{1.2f, -9.0f, 1.0f}, 2});
+    octree.Add({{5.0f, 5.0f, 5.0f}, 3});
+    EXPECT_EQ(entered, (std::vector<int>{1, 2}));
+    EXPECT_EQ(octree.GetOctree().Query(StandingOctree::Sphere{{1.2f, 1.0f, 1.0f}, 0.5f}).size(), 2);
+}
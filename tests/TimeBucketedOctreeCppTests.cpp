@@ -0,0 +1,77 @@
+#include <octree-cpp/TimeBucketedOctreeCpp.h>
+#include <gtest/gtest.h>
+#include <random>
+
+struct vec {
+    float x, y, z;
+    auto operator<=>(const vec&) const = default;
+};
+
+struct Detection {
+    double Time;
+    int Id;
+};
+
+struct TimeOfDetection {
+    double operator()(const Detection& Data) const {
+        return Data.Time;
+    }
+};
+
+using TimeOctree = TimeBucketedOctreeCpp<vec, Detection, TimeOfDetection>;
+
+TEST(TimeBucketedOctreeCppTest, TimeOctreeAdd) {
+    TimeOctree octree({{0, 0, 0}, {1, 1, 1}}, 1.0, 60);
+    octree.Add({{0.5f, 0.5f, 0.5f}, {0.5, 1}});
+    octree.Add({{0.5f, 0.5f, 0.5f}, {10.5, 2}});
+    EXPECT_EQ(octree.Size(), 2);
+    EXPECT_EQ(octree.NrLiveBuckets(), 2);
+    EXPECT_THROW(octree.Add({{2.0f, 0.5f, 0.5f}, {10.5, 3}}), std::runtime_error);
+    EXPECT_THROW(TimeOctree({{0, 0, 0}, {1, 1, 1}}, 0.0, 60), std::runtime_error);
+    EXPECT_THROW(TimeOctree({{0, 0, 0}, {1, 1, 1}}, 1.0, 0), std::runtime_error);
+}
+
+TEST(TimeBucketedOctreeCppTest, TimeOctreeSlidingWindow) {
+    TimeOctree octree({{0, 0, 0}, {1, 1, 1}}, 1.0, 60);
+    for (int i = 0; i < 100; i++) {
+        octree.Add({{0.5f, 0.5f, 0.5f}, {static_cast<double>(i), i}});
+    }
+    // Only the last 60 seconds are kept, older buckets are dropped when the window moves.
+    EXPECT_EQ(octree.Size(), 60);
+    EXPECT_EQ(octree.NrLiveBuckets(), 60);
+    EXPECT_THROW(octree.Add({{0.5f, 0.5f, 0.5f}, {10.0, -1}}), std::runtime_error);
+
+    octree.Expire(90.0);
+    EXPECT_EQ(octree.Size(), 10);
+    auto hits = octree.Query(TimeOctree::All(), 0.0, 1000.0);
+    ASSERT_EQ(hits.size(), 10);
+    for (const auto& hit : hits) {
+        EXPECT_GE(hit.Data.Time, 90.0);
+    }
+}
+
+TEST(TimeBucketedOctreeCppTest, TimeOctreeQueryTimeRange) {
+    TimeOctree octree({{0, 0, 0}, {10, 10, 10}}, 2.5, 30);
+    std::vector<TimeOctree::TDataWrapper> points;
+    std::mt19937 gen(35);
+    std::uniform_real_distribution<float> dis(0.0f, 10.0f);
+    std::uniform_real_distribution<double> time(0.0, 75.0);
+    for (int i = 0; i < 5000; i++) {
+        points.push_back({{dis(gen), dis(gen), dis(gen)}, {time(gen), i}});
+        octree.Add(points.back());
+    }
+
+    auto sphere = TimeOctree::Sphere{{5.0f, 5.0f, 5.0f}, 3.0f};
+    for (auto [from, to] : {std::pair{0.0, 75.0}, {10.0, 20.0}, {11.3, 12.1}, {70.0, 100.0}, {-10.0, -1.0}}) {
+        size_t expected = 0;
+        for (const auto& point : points) {
+            expected += sphere.IsInside(point) && point.Data.Time >= from && point.Data.Time <= to;
+        }
+        auto hits = octree.QueryRefs(sphere, from, to);
+        EXPECT_EQ(hits.size(), expected);
+        for (const auto& hit : hits) {
+            EXPECT_GE(hit.get().Data.Time, from);
+            EXPECT_LE(hit.get().Data.Time, to);
+        }
+    }
+}